@@ -0,0 +1,247 @@
+/// Measures overhead of the bootstrapper itself on top of `fake_hostfxr`. Results of these paths are checked once per
+/// case by `test/results.cpp`, so this only reports what the last call returned
+
+#include "bootstrapper.h"
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+
+/// Must match `FakeFailure` of fake_hostfxr
+enum class FakeFailure : uint32_t {
+    None,
+    InitializeRuntimeConfig,
+    GetRuntimeDelegate,
+    LoadAssembly,
+    GetRuntimeProperty,
+};
+
+typedef void (*fake_hostfxr_configure_fn)(uint64_t latency_ns, FakeFailure failure);
+typedef uint64_t (*fake_hostfxr_entry_point_calls_fn)();
+
+/// Writes runtime config into a temporary file and returns its path, empty on failure
+static std::string writeRuntimeConfig(const char *json) {
+    char path[] = "/tmp/benchmark.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return {};
+    }
+
+    auto size = (ssize_t) strlen(json);
+    auto written = write(fd, json, (size_t) size);
+    close(fd);
+    return written == size ? path : std::string();
+}
+
+/// Runs `op` `iterations` times and prints ns/op with the result of the last run,
+/// `ops_per_iteration` is for ops that do several operations at once
+static void run(const char *name, size_t iterations, const std::function<InitializeResult()> &op,
+                size_t ops_per_iteration = 1) {
+    iterations = std::max<size_t>(iterations, 1);
+    auto result = InitializeResult::Success;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        result = op();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    printf("%-32s %-30s %10zu %14.1f ns/op\n", name, resultName(result), iterations * ops_per_iteration,
+           (double) elapsed.count() / (double) (iterations * ops_per_iteration));
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    const char *runtime_config_path = "fake.runtimeconfig.json";
+    const char *assembly_path = "fake.dll";
+    const char *type_name = "Fake.Main, Fake";
+    const char *method_name = "InitializePatches";
+
+    auto load = [&] {
+        return bootstrapper_load_assembly(runtime_config_path, assembly_path, type_name, method_name);
+    };
+
+    printf("%-32s %-30s %10s %14s\n", "benchmark", "result", "iterations", "time");
+
+    /// hostfxr is not mapped yet
+    run("load (hostfxr missing)", 1, load);
+
+    /// First load finds nothing mapped, loads hostfxr from explicit path and caches its exports
+    bootstrapper_set_hostfxr_path(FAKE_HOSTFXR_PATH);
+    run("load (cold, path override)", 1, load);
+
+    auto fake = dlopen(FAKE_HOSTFXR_PATH, RTLD_NOW | RTLD_NOLOAD);
+    if (!fake) {
+        fprintf(stderr, "%s is not loaded: %s\n", FAKE_HOSTFXR_PATH, dlerror());
+        return 1;
+    }
+    auto configure = reinterpret_cast<fake_hostfxr_configure_fn>(dlsym(fake, "fake_hostfxr_configure"));
+    auto entry_point_calls = reinterpret_cast<fake_hostfxr_entry_point_calls_fn>(
+        dlsym(fake, "fake_hostfxr_entry_point_calls"));
+
+    run("load (warm)", iterations, load);
+
+    Session *session = nullptr;
+    if (bootstrapper_open_session(runtime_config_path, &session) != InitializeResult::Success) {
+        fprintf(stderr, "failed to open session\n");
+        return 1;
+    }
+    run("session_load (warm)", iterations, [&] {
+        return bootstrapper_session_load(session, assembly_path, type_name, method_name);
+    });
+    static const char bytes[] = "MZ";
+    auto load_bytes = [&] {
+        return bootstrapper_session_load_bytes(session, bytes, sizeof(bytes), nullptr, 0, type_name, method_name);
+    };
+    run("session_load_bytes", 1, load_bytes);
+    run("session_load_bytes (repeat)", iterations, load_bytes);
+    bootstrapper_close_session(session);
+
+    /// `fake.dll` doesn't exist, so every load above went all the way. A readable payload is loaded only once,
+    /// repeats cost a stat and a hash lookup, and its entry point is never called again. Content differs from
+    /// `bytes`, the same content would be the same payload
+    static const char file_bytes[] = "MZ file";
+    char payload_path[] = "/tmp/benchmark.XXXXXX";
+    int payload_fd = mkstemp(payload_path);
+    if (payload_fd < 0 || write(payload_fd, file_bytes, sizeof(file_bytes)) != sizeof(file_bytes)) {
+        fprintf(stderr, "failed to create %s\n", payload_path);
+        return 1;
+    }
+    close(payload_fd);
+
+    auto load_payload = [&] {
+        return bootstrapper_load_assembly(runtime_config_path, payload_path, type_name, method_name);
+    };
+    run("load (readable payload)", 1, load_payload);
+    auto calls = entry_point_calls();
+    run("load (already loaded)", iterations, [&] {
+        auto ret = load_payload();
+        return entry_point_calls() == calls ? ret : InitializeResult::Success;
+    });
+    unlink(payload_path);
+
+    char arg[16] = {};
+    run("invoke (cold)", 1, [&] {
+        return bootstrapper_invoke(runtime_config_path, assembly_path, type_name, "Toggle", arg, sizeof(arg), nullptr);
+    });
+    run("invoke (warm)", iterations, [&] {
+        int32_t result = 0;
+        auto ret = bootstrapper_invoke(runtime_config_path, assembly_path, type_name, "Toggle", arg, sizeof(arg),
+                                       &result);
+        return result == sizeof(arg) ? ret : InitializeResult::EntryPointError;
+    });
+
+    /// Round trip through the worker thread
+    run("load_assembly_async + wait", iterations / 10, [&] {
+        auto ticket = bootstrapper_load_assembly_async(runtime_config_path, assembly_path, type_name, method_name);
+        TicketReport report{};
+        if (bootstrapper_wait(ticket, 10000, &report) != TicketStatus::Completed) {
+            return InitializeResult::EntryPointError;
+        }
+        return report.load.result;
+    });
+
+    /// Messages are sent one by one and the last one is awaited, so this is throughput of the consumer
+    auto channel_name = "benchmark." + std::to_string(getpid());
+    auto channel = bootstrapper_open_channel(channel_name.c_str(), 1024, 64, runtime_config_path, assembly_path,
+                                             type_name, "HandleCommand");
+    if (!channel) {
+        fprintf(stderr, "failed to open channel\n");
+        return 1;
+    }
+    run("channel_send (until consumed)", 1, [&] {
+        auto expected = entry_point_calls() + iterations;
+        for (size_t i = 0; i < iterations; ++i) {
+            while (!bootstrapper_channel_send(channel, arg, sizeof(arg))) {
+            }
+        }
+        while (entry_point_calls() < expected) {
+        }
+        return InitializeResult::Success;
+    }, iterations);
+    bootstrapper_close_channel(channel);
+
+    /// What every instrumented call of a patched method pays on top of reading the clock twice
+    auto stats_id = bootstrapper_stats_register("benchmark");
+    run("stats_record", iterations, [&] {
+        bootstrapper_stats_record(stats_id, 1500);
+        return stats_id >= 0 ? InitializeResult::Success : InitializeResult::EntryPointError;
+    });
+
+    AssemblyDescriptor descriptors[16];
+    InitializeResult results[16];
+    for (auto &descriptor: descriptors) {
+        descriptor = {assembly_path, type_name, method_name};
+    }
+    run("load_assemblies (16 payloads)", iterations / 16, [&] {
+        auto ret = bootstrapper_load_assemblies(runtime_config_path, descriptors, 16, results);
+        for (auto result: results) {
+            if (result != InitializeResult::Success) {
+                return result;
+            }
+        }
+        return ret;
+    });
+
+    /// Verdict is mapped to the result that load would have returned
+    auto probe = [&] {
+        ProbeReport report;
+        auto ret = bootstrapper_probe(runtime_config_path, &report);
+        if (ret != InitializeResult::Success) {
+            return ret;
+        }
+        return report.verdict == ProbeVerdict::Compatible ? ret : InitializeResult::InitializeRuntimeConfigError;
+    };
+    run("probe", iterations, probe);
+
+    configure(0, FakeFailure::InitializeRuntimeConfig);
+    run("load (config error)", iterations, load);
+    run("probe (framework missing)", iterations, probe);
+
+    configure(0, FakeFailure::GetRuntimeDelegate);
+    run("load (delegate error)", iterations, load);
+
+    configure(0, FakeFailure::LoadAssembly);
+    run("load (entry point error)", iterations, load);
+
+    /// From now on the runtime looks loaded, so probe judges configs by frameworks and properties of the running app
+    /// (see `hostfxr_get_runtime_property_value` of fake_hostfxr) instead of resolving them
+    configure(0, FakeFailure::None);
+    if (!dlopen(FAKE_CORECLR_PATH, RTLD_NOW)) {
+        fprintf(stderr, "failed to load %s: %s\n", FAKE_CORECLR_PATH, dlerror());
+        return 1;
+    }
+
+    auto fitting = writeRuntimeConfig(
+        R"({"runtimeOptions": {"framework": {"name": "Microsoft.NETCore.App", "version": "10.0.0"}}})");
+    run("probe (running)", iterations / 100, [&] {
+        ProbeReport report;
+        auto ret = bootstrapper_probe(fitting.c_str(), &report);
+        if (ret != InitializeResult::Success) {
+            return ret;
+        }
+        return report.verdict == ProbeVerdict::Compatible ? ret : InitializeResult::InitializeRuntimeConfigError;
+    });
+    unlink(fitting.c_str());
+
+    /// 10 us per hostfxr call shows how much of the total is spent inside of hostfxr
+    configure(10000, FakeFailure::None);
+    run("load (10us hostfxr latency)", iterations / 100, load);
+
+    LoadReport report{};
+    bootstrapper_get_last_report(&report);
+    const char *phases[] = {"ModuleLookup", "InitializeRuntimeConfig", "GetRuntimeDelegate", "Prefetch", "LoadAssembly",
+                            "EntryPoint"};
+    for (size_t i = 0; i < (size_t) Phase::Count; ++i) {
+        printf("  %-30s %10llu ns\n", phases[i], (unsigned long long) report.phases[i].duration_ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+/// Stand-in for `libcoreclr.so`: mapping it makes the runtime look loaded to the bootstrapper, which takes the running
+/// version from its directory, `shared/Microsoft.NETCore.App/<version>/`. Nothing is ever called in it
+
+#define EXPORT [[gnu::visibility("default")]]
+
+#include <cstdint>
+
+extern "C" EXPORT int32_t fake_coreclr_version() {
+    return 10;
+}
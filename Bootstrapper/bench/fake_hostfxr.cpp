@@ -0,0 +1,198 @@
+/// Stand-in for `libhostfxr.so` that implements just enough of `hostfxr.h` to drive the bootstrapper
+/// without .NET runtime. Latency and failures are configured via `fake_hostfxr_configure` or
+/// `FAKE_HOSTFXR_LATENCY_NS` / `FAKE_HOSTFXR_FAILURE` environment variables
+
+#define EXPORT [[gnu::visibility("default")]]
+
+#include <hostfxr.h>
+#include <coreclr_delegates.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+/// Which call should fail, must match the `failure` argument of `fake_hostfxr_configure`
+enum class FakeFailure : uint32_t {
+    None,
+    InitializeRuntimeConfig,
+    GetRuntimeDelegate,
+    LoadAssembly,
+    /// As if there was no active host context, e.g. the runtime was started by a custom host
+    GetRuntimeProperty,
+};
+
+static std::atomic<uint64_t> latency_ns = [] {
+    auto value = std::getenv("FAKE_HOSTFXR_LATENCY_NS");
+    return value ? std::strtoull(value, nullptr, 10) : 0;
+}();
+
+static std::atomic<FakeFailure> failure = [] {
+    auto value = std::getenv("FAKE_HOSTFXR_FAILURE");
+    return value ? (FakeFailure) std::strtoul(value, nullptr, 10) : FakeFailure::None;
+}();
+
+static std::atomic<uint64_t> entry_point_calls = 0;
+
+static int context;
+
+/// Busy-waits instead of sleeping, so that nanosecond latencies are honored
+static void simulateLatency() {
+    auto latency = std::chrono::nanoseconds(latency_ns.load(std::memory_order_relaxed));
+    if (latency.count() == 0) {
+        return;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + latency;
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+}
+
+static bool shouldFail(FakeFailure at) {
+    return failure.load(std::memory_order_relaxed) == at;
+}
+
+/// Serves both as `void()` payload entry point and `component_entry_point_fn`
+static int CORECLR_DELEGATE_CALLTYPE entry_point(void *, int32_t arg_size) {
+    entry_point_calls.fetch_add(1, std::memory_order_relaxed);
+    return arg_size;
+}
+
+static int CORECLR_DELEGATE_CALLTYPE load_assembly_and_get_function_pointer(
+    const char_t *, const char_t *, const char_t *, const char_t *, void *, void **delegate
+) {
+    simulateLatency();
+    if (shouldFail(FakeFailure::LoadAssembly)) {
+        return (int) 0x80131522; /// COR_E_TYPELOAD
+    }
+
+    *delegate = (void *) entry_point;
+    return 0;
+}
+
+static int CORECLR_DELEGATE_CALLTYPE get_function_pointer(
+    const char_t *, const char_t *, const char_t *, void *, void *, void **delegate
+) {
+    simulateLatency();
+    if (shouldFail(FakeFailure::LoadAssembly)) {
+        return (int) 0x80131522; /// COR_E_TYPELOAD
+    }
+
+    *delegate = (void *) entry_point;
+    return 0;
+}
+
+static int CORECLR_DELEGATE_CALLTYPE load_assembly_bytes(const void *, size_t, const void *, size_t, void *, void *) {
+    simulateLatency();
+    return shouldFail(FakeFailure::LoadAssembly) ? (int) 0x80131018 /* COR_E_ASSEMBLYEXPECTED */ : 0;
+}
+
+extern "C" EXPORT void fake_hostfxr_configure(uint64_t latency, FakeFailure at) {
+    latency_ns = latency;
+    failure = at;
+}
+
+extern "C" EXPORT uint64_t fake_hostfxr_entry_point_calls() {
+    return entry_point_calls;
+}
+
+extern "C" EXPORT int32_t hostfxr_initialize_for_runtime_config(
+    const char_t *, const hostfxr_initialize_parameters *, hostfxr_handle *host_context_handle
+) {
+    simulateLatency();
+    if (shouldFail(FakeFailure::InitializeRuntimeConfig)) {
+        *host_context_handle = nullptr;
+        return (int32_t) 0x80008093; /// InvalidConfigFile
+    }
+
+    *host_context_handle = &context;
+    return 1; /// Success_HostAlreadyInitialized
+}
+
+extern "C" EXPORT int32_t hostfxr_get_runtime_delegate(
+    const hostfxr_handle, hostfxr_delegate_type type, void **delegate
+) {
+    simulateLatency();
+    if (shouldFail(FakeFailure::GetRuntimeDelegate)) {
+        return (int32_t) 0x80008097; /// HostInvalidState
+    }
+
+    switch (type) {
+        case hdt_load_assembly_and_get_function_pointer:
+            *delegate = (void *) load_assembly_and_get_function_pointer;
+            return 0;
+        case hdt_get_function_pointer:
+            *delegate = (void *) get_function_pointer;
+            return 0;
+        case hdt_load_assembly_bytes:
+            *delegate = (void *) load_assembly_bytes;
+            return 0;
+        default:
+            return (int32_t) 0x80008081; /// HostApiUnsupportedVersion
+    }
+}
+
+extern "C" EXPORT int32_t hostfxr_close(const hostfxr_handle) {
+    return 0;
+}
+
+extern "C" EXPORT int32_t hostfxr_get_dotnet_environment_info(
+    const char_t *, void *, hostfxr_get_dotnet_environment_info_result_fn result, void *result_context
+) {
+    simulateLatency();
+    hostfxr_dotnet_environment_info info{sizeof(hostfxr_dotnet_environment_info), "0.0.0-fake", "", 0, nullptr, 0, nullptr};
+    result(&info, result_context);
+    return 0;
+}
+
+/// Resolves single framework, which is missing while config failure is injected
+extern "C" EXPORT int32_t hostfxr_resolve_frameworks_for_runtime_config(
+    const char_t *, const hostfxr_initialize_parameters *, hostfxr_resolve_frameworks_result_fn callback,
+    void *result_context
+) {
+    simulateLatency();
+    auto missing = shouldFail(FakeFailure::InitializeRuntimeConfig);
+
+    hostfxr_framework_result framework{
+        sizeof(hostfxr_framework_result),
+        "Microsoft.NETCore.App",
+        "10.0.0",
+        missing ? nullptr : "10.0.0",
+        missing ? nullptr : "/fake/shared/Microsoft.NETCore.App/10.0.0",
+    };
+    hostfxr_resolve_frameworks_result result{
+        sizeof(hostfxr_resolve_frameworks_result),
+        missing ? 0u : 1u,
+        missing ? nullptr : &framework,
+        missing ? 1u : 0u,
+        missing ? &framework : nullptr,
+    };
+    if (callback) {
+        callback(&result, result_context);
+    }
+    return missing ? (int32_t) 0x80008096 /* FrameworkMissingFailure */ : 0;
+}
+
+/// Properties of the app that is "running" once `fake_coreclr` is mapped: it has loaded Microsoft.NETCore.App and
+/// Microsoft.AspNetCore.App 10.0.1, the version `fake_coreclr` is placed under
+extern "C" EXPORT int32_t hostfxr_get_runtime_property_value(
+    const hostfxr_handle, const char_t *name, const char_t **value
+) {
+    simulateLatency();
+    if (shouldFail(FakeFailure::GetRuntimeProperty)) {
+        return (int32_t) 0x80008097; /// HostInvalidState
+    }
+
+    if (strcmp(name, "TRUSTED_PLATFORM_ASSEMBLIES") == 0) {
+        *value = "/fake/app/App.dll:"
+                 "/fake/shared/Microsoft.NETCore.App/10.0.1/System.Private.CoreLib.dll:"
+                 "/fake/shared/Microsoft.NETCore.App/10.0.1/System.Runtime.dll:"
+                 "/fake/shared/Microsoft.AspNetCore.App/10.0.1/Microsoft.AspNetCore.dll";
+        return 0;
+    }
+    if (strcmp(name, "System.GC.Server") == 0) {
+        *value = "true";
+        return 0;
+    }
+    return (int32_t) 0x800080a4; /// HostPropertyNotFound
+}
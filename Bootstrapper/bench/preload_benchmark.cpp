@@ -0,0 +1,123 @@
+/// Measures what `LD_PRELOAD` of the bootstrapper adds to every exec of a process that isn't a target,
+/// e.g. shell wrapper of the .NET worker or its other children
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern char **environ;
+
+static int failures = 0;
+
+/// Environment of the current process plus extra variables
+static std::vector<std::string> makeEnvironment(const std::vector<std::string> &variables) {
+    std::vector<std::string> environment;
+    for (auto env = environ; *env; ++env) {
+        environment.emplace_back(*env);
+    }
+    environment.insert(environment.end(), variables.begin(), variables.end());
+    return environment;
+}
+
+/// Spawns `program` `iterations` times and returns total time
+static std::chrono::nanoseconds measure(const char *program, size_t iterations, std::vector<std::string> &environment) {
+    std::vector<char *> envp;
+    for (auto &variable: environment) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+
+    char *argv[] = {const_cast<char *>(program), nullptr};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid;
+        int status;
+        if (posix_spawn(&pid, program, nullptr, nullptr, argv, envp.data()) != 0 ||
+            waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failures;
+            return {};
+        }
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+/// Config with `count` entries that don't match `true`, the last one may require reading command line
+static std::string writeConfig(size_t count, bool cmdline) {
+    char path[] = "/tmp/preload_benchmark.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        ++failures;
+        return {};
+    }
+
+    std::string config;
+    for (size_t i = 0; i < count; ++i) {
+        config += "[payload]\n";
+        config += cmdline && i + 1 == count ? "cmdline = --worker\n" : "exe = Worker" + std::to_string(i) + "*\n";
+        config += "runtime_config_path = /app/Worker.runtimeconfig.json\n"
+                  "assembly_path = /app/RuntimePatcher.dll\n"
+                  "type_name = RuntimePatcher.Main, RuntimePatcher\n"
+                  "method_name = InitializePatches\n";
+    }
+
+    write(fd, config.data(), config.size());
+    close(fd);
+    return path;
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500;
+    const char *program = argc > 2 ? argv[2] : "/bin/true";
+
+    std::string preload = std::string("LD_PRELOAD=") + BOOTSTRAPPER_PATH;
+    auto exe_config = writeConfig(16, false);
+    auto cmdline_config = writeConfig(16, true);
+
+    struct Scenario {
+        const char *name;
+        std::vector<std::string> variables;
+    } scenarios[] = {
+        {"no preload", {}},
+        {"preload, nothing configured", {preload}},
+        {"preload, 16 exe rules", {preload, "BOOTSTRAPPER_CONFIG=" + exe_config}},
+        {"preload, 16 rules with cmdline", {preload, "BOOTSTRAPPER_CONFIG=" + cmdline_config}},
+        {"preload, env match (no runtime)", {preload, "RUNTIME_CONFIG_PATH=/app/Worker.runtimeconfig.json",
+                                             "ASSEMBLY_PATH=/app/RuntimePatcher.dll",
+                                             "TYPE_NAME=RuntimePatcher.Main, RuntimePatcher",
+                                             "METHOD_NAME=InitializePatches"}},
+    };
+
+    /// Scenarios are interleaved in rounds, so frequency scaling and noisy neighbours affect all of them equally
+    constexpr size_t rounds = 10;
+    std::vector<std::vector<std::string>> environments;
+    std::vector<std::chrono::nanoseconds> totals(std::size(scenarios));
+    for (auto &scenario: scenarios) {
+        environments.push_back(makeEnvironment(scenario.variables));
+    }
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < std::size(scenarios); ++i) {
+            totals[i] += measure(program, (iterations + rounds - 1) / rounds, environments[i]);
+        }
+    }
+
+    printf("%-36s %10s %14s %14s\n", "scenario", "execs", "time", "overhead");
+
+    auto execs = (iterations + rounds - 1) / rounds * rounds;
+    auto baseline = (double) totals[0].count() / (double) execs / 1000.0;
+    for (size_t i = 0; i < std::size(scenarios); ++i) {
+        auto time = (double) totals[i].count() / (double) execs / 1000.0;
+        printf("%-36s %10zu %11.1f us %11.1f us\n", scenarios[i].name, execs, time, time - baseline);
+    }
+
+    unlink(exe_config.c_str());
+    unlink(cmdline_config.c_str());
+
+    return failures == 0 ? 0 : 1;
+}
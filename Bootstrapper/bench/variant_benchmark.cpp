@@ -0,0 +1,234 @@
+/// Compares what the full and the minimal bootstrapper cost a process they are preloaded into and that doesn't
+/// match: exec time, mapped and dirtied memory, and relocations the dynamic linker has to apply
+
+#include <elf.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern char **environ;
+
+static int failures = 0;
+
+/// What the dynamic linker does with the library, read from its file
+struct ElfInfo {
+    size_t file_size = 0;
+    size_t relocations = 0;
+    /// Relocations that need symbol lookup, the rest only add load base
+    size_t symbol_relocations = 0;
+    size_t needed = 0;
+    size_t exports = 0;
+};
+
+static ElfInfo readElfInfo(const char *path) {
+    ElfInfo info;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(Elf64_Ehdr) || memcmp(data.data(), ELFMAG, SELFMAG) != 0 ||
+        data[EI_CLASS] != ELFCLASS64) {
+        ++failures;
+        return info;
+    }
+    info.file_size = data.size();
+
+    auto header = reinterpret_cast<const Elf64_Ehdr *>(data.data());
+    auto sections = reinterpret_cast<const Elf64_Shdr *>(data.data() + header->e_shoff);
+    for (size_t i = 0; i < header->e_shnum; ++i) {
+        auto &section = sections[i];
+        auto begin = data.data() + section.sh_offset;
+        if (section.sh_type == SHT_RELA) {
+            auto relocations = reinterpret_cast<const Elf64_Rela *>(begin);
+            for (size_t j = 0; j < section.sh_size / sizeof(Elf64_Rela); ++j) {
+                ++info.relocations;
+                info.symbol_relocations += ELF64_R_SYM(relocations[j].r_info) != 0;
+            }
+        } else if (section.sh_type == SHT_DYNAMIC) {
+            auto entries = reinterpret_cast<const Elf64_Dyn *>(begin);
+            for (size_t j = 0; j < section.sh_size / sizeof(Elf64_Dyn); ++j) {
+                info.needed += entries[j].d_tag == DT_NEEDED;
+            }
+        } else if (section.sh_type == SHT_DYNSYM) {
+            auto symbols = reinterpret_cast<const Elf64_Sym *>(begin);
+            for (size_t j = 0; j < section.sh_size / sizeof(Elf64_Sym); ++j) {
+                info.exports += symbols[j].st_shndx != SHN_UNDEF && ELF64_ST_TYPE(symbols[j].st_info) == STT_FUNC;
+            }
+        }
+    }
+    return info;
+}
+
+/// Environment of the current process plus extra variables
+static std::vector<std::string> makeEnvironment(const std::vector<std::string> &variables) {
+    std::vector<std::string> environment;
+    for (auto env = environ; *env; ++env) {
+        environment.emplace_back(*env);
+    }
+    environment.insert(environment.end(), variables.begin(), variables.end());
+    return environment;
+}
+
+static std::vector<char *> makeEnvp(std::vector<std::string> &environment) {
+    std::vector<char *> envp;
+    for (auto &variable: environment) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+    return envp;
+}
+
+/// Spawns `program` `iterations` times and returns total time
+static std::chrono::nanoseconds measureExec(const char *program, size_t iterations,
+                                            std::vector<std::string> &environment) {
+    auto envp = makeEnvp(environment);
+    char *argv[] = {const_cast<char *>(program), nullptr};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid;
+        int status;
+        if (posix_spawn(&pid, program, nullptr, nullptr, argv, envp.data()) != 0 ||
+            waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failures;
+            return {};
+        }
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+/// Memory of a process, in kB
+struct MemoryInfo {
+    size_t mapped = 0;
+    size_t rss = 0;
+    size_t private_dirty = 0;
+};
+
+/// Reads "<field>: <value> kB" line of `/proc/<pid>/smaps_rollup`
+static size_t readSmapsField(const std::string &smaps, const char *field) {
+    auto position = smaps.find(std::string("\n") + field + ":");
+    return position == std::string::npos ? 0 : std::strtoull(smaps.c_str() + position + strlen(field) + 2, nullptr, 10);
+}
+
+/// Starts `cat` and measures it once it echoed a byte back, i.e. once the dynamic linker and constructors are done
+static MemoryInfo measureMemory(std::vector<std::string> &environment) {
+    auto envp = makeEnvp(environment);
+    char *argv[] = {const_cast<char *>("/bin/cat"), nullptr};
+
+    int input[2], output[2];
+    if (pipe(input) != 0 || pipe(output) != 0) {
+        ++failures;
+        return {};
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, input[1]);
+    posix_spawn_file_actions_addclose(&actions, output[0]);
+
+    pid_t pid;
+    auto spawned = posix_spawn(&pid, argv[0], &actions, nullptr, argv, envp.data()) == 0;
+    posix_spawn_file_actions_destroy(&actions);
+    close(input[0]);
+    close(output[1]);
+
+    MemoryInfo info;
+    char byte = 'x';
+    if (!spawned || write(input[1], &byte, 1) != 1 || read(output[0], &byte, 1) != 1) {
+        ++failures;
+    } else {
+        std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+        std::string line;
+        while (std::getline(maps, line)) {
+            unsigned long long begin, end;
+            if (sscanf(line.c_str(), "%llx-%llx", &begin, &end) == 2) {
+                info.mapped += (end - begin) / 1024;
+            }
+        }
+
+        std::ifstream rollup("/proc/" + std::to_string(pid) + "/smaps_rollup");
+        std::string smaps = "\n" + std::string((std::istreambuf_iterator<char>(rollup)), std::istreambuf_iterator<char>());
+        info.rss = readSmapsField(smaps, "Rss");
+        info.private_dirty = readSmapsField(smaps, "Private_Dirty");
+    }
+
+    close(input[1]);
+    close(output[0]);
+    if (spawned) {
+        int status;
+        waitpid(pid, &status, 0);
+    }
+    return info;
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500;
+    const char *program = argc > 2 ? argv[2] : "/bin/true";
+
+    struct Variant {
+        const char *name;
+        const char *path;
+        std::vector<std::string> environment{};
+        ElfInfo elf{};
+        std::chrono::nanoseconds total{};
+        std::vector<MemoryInfo> memory{};
+    } variants[] = {
+        {"no preload", nullptr},
+        {"full", BOOTSTRAPPER_PATH},
+        {"minimal", MINIMAL_BOOTSTRAPPER_PATH},
+    };
+
+    for (auto &variant: variants) {
+        std::vector<std::string> variables;
+        if (variant.path) {
+            variables.push_back(std::string("LD_PRELOAD=") + variant.path);
+            variant.elf = readElfInfo(variant.path);
+        }
+        variant.environment = makeEnvironment(variables);
+    }
+
+    /// Variants are interleaved in rounds, so frequency scaling and noisy neighbours affect all of them equally
+    constexpr size_t rounds = 10;
+    for (size_t round = 0; round < rounds; ++round) {
+        for (auto &variant: variants) {
+            variant.total += measureExec(program, (iterations + rounds - 1) / rounds, variant.environment);
+            variant.memory.push_back(measureMemory(variant.environment));
+        }
+    }
+
+    printf("%-12s %9s %7s %10s %7s %8s %10s %11s %10s %9s %9s\n", "variant", "file kB", "relocs", "sym relocs",
+           "needed", "exports", "exec", "overhead", "mapped kB", "rss kB", "dirty kB");
+
+    auto execs = (iterations + rounds - 1) / rounds * rounds;
+    auto baseline = (double) variants[0].total.count() / (double) execs / 1000.0;
+    for (auto &variant: variants) {
+        /// Memory of the same process barely moves, the median drops the odd sample taken during page cache churn
+        auto median = [&](size_t MemoryInfo::*field) {
+            std::vector<size_t> values;
+            for (auto &memory: variant.memory) {
+                values.push_back(memory.*field);
+            }
+            std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+            return values[values.size() / 2];
+        };
+
+        auto time = (double) variant.total.count() / (double) execs / 1000.0;
+        printf("%-12s %9zu %7zu %10zu %7zu %8zu %7.1f us %8.1f us %10zu %9zu %9zu\n", variant.name,
+               variant.elf.file_size / 1024, variant.elf.relocations, variant.elf.symbol_relocations,
+               variant.elf.needed, variant.elf.exports, time, time - baseline, median(&MemoryInfo::mapped),
+               median(&MemoryInfo::rss), median(&MemoryInfo::private_dirty));
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef Bootstrapper_EXPORTS
+#define EXPORT __declspec(dllexport)
+#else
+#define EXPORT __declspec(dllimport)
+#endif
+#else
+#define EXPORT [[gnu::visibility("default")]]
+#endif
+
+#include <hostfxr.h>
+#include <coreclr_delegates.h>
+
+/// This enums represents possible errors to hide it from others
+/// useful for debugging
+enum class InitializeResult : uint32_t {
+    Success,
+    HostFxrLoadError,
+    InitializeRuntimeConfigError,
+    GetRuntimeDelegateError,
+    EntryPointError,
+    /// The same assembly content with the same entry point was already loaded into the process, nothing was done
+    AlreadyLoaded,
+};
+
+/// Name of the enumerator for logs, `Unknown` for values this header doesn't know
+inline const char *resultName(InitializeResult result) {
+    switch (result) {
+        case InitializeResult::Success:
+            return "Success";
+        case InitializeResult::HostFxrLoadError:
+            return "HostFxrLoadError";
+        case InitializeResult::InitializeRuntimeConfigError:
+            return "InitializeRuntimeConfigError";
+        case InitializeResult::GetRuntimeDelegateError:
+            return "GetRuntimeDelegateError";
+        case InitializeResult::EntryPointError:
+            return "EntryPointError";
+        case InitializeResult::AlreadyLoaded:
+            return "AlreadyLoaded";
+    }
+    return "Unknown";
+}
+
+/// Phases of injection that are measured separately in `LoadReport`
+enum class Phase : uint32_t {
+    ModuleLookup,
+    InitializeRuntimeConfig,
+    GetRuntimeDelegate,
+    /// Hashing the payload for `AlreadyLoaded` check and reading its dependencies into page cache
+    Prefetch,
+    LoadAssembly,
+    EntryPoint,
+    Count,
+};
+
+struct PhaseReport {
+    uint64_t duration_ns;
+    int64_t rss_delta_bytes;
+};
+
+/// Timings and memory growth of the last injection, see `bootstrapper_get_last_report`
+struct LoadReport {
+    InitializeResult result;
+    PhaseReport phases[(size_t) Phase::Count];
+    /// Dependencies from `.deps.json` of the payload that were read ahead during `Phase::Prefetch`
+    uint32_t prefetch_files;
+    uint64_t prefetch_bytes;
+    /// Wall time of reading them, part of `Phase::Prefetch`
+    uint64_t prefetch_ns;
+};
+
+/// State of injection submitted via `bootstrapper_load_assembly_async`
+enum class TicketStatus : uint32_t {
+    Unknown,
+    Pending,
+    Running,
+    Completed,
+};
+
+/// Scheduling of the bootstrapper worker thread, so assembly load and JIT don't compete with threads of the app,
+/// see `bootstrapper_set_worker_policy`
+struct WorkerPolicy {
+    /// Nice value of the worker thread, e.g. 10, ignored on Windows except that positive value lowers thread priority
+    int32_t nice;
+    /// Non-zero puts the worker under `SCHED_IDLE` (`THREAD_PRIORITY_IDLE` on Windows), so it runs only on idle CPUs
+    uint32_t idle;
+    /// Bit `i` allows CPU `i`, 0 keeps affinity of the process
+    uint64_t affinity_mask;
+    /// Non-zero defers every job until CPU usage of the whole process drops below this many percent of one core
+    uint32_t defer_cpu_percent;
+    /// Job starts anyway once it was deferred for this long
+    uint32_t defer_max_ms;
+};
+
+struct TicketReport {
+    TicketStatus status;
+    /// How long the job waited for the worker, including deferral
+    uint64_t queue_ns;
+    /// Result and timings of the injection itself, valid once `status == Completed`
+    LoadReport load;
+    /// How long the job was deferred because the process was busy
+    uint64_t deferred_ns;
+    /// CPU usage of the process in percent of one core when the job was started, measured only if deferral is on
+    uint32_t cpu_percent;
+    /// Scheduling the job actually ran with, read back from the thread, so settings the OS refused are visible
+    WorkerPolicy policy;
+};
+
+/// Whether runtime config can be loaded into the process, see `bootstrapper_probe`
+enum class ProbeVerdict : uint32_t {
+    /// Frameworks of the running app can't be listed (no active host context, e.g. custom host), or the runtime is not
+    /// loaded yet and hostfxr is older than .NET 9, so it can't resolve frameworks without initializing
+    Unknown,
+    Compatible,
+    Incompatible,
+};
+
+static constexpr size_t PROBE_MAX_FRAMEWORKS = 8;
+
+/// Framework requested by runtime config, strings are truncated to fit
+struct ProbeFramework {
+    uint32_t resolved;
+    char_t name[64];
+    char_t requested_version[32];
+    char_t resolved_version[32];
+    /// Version the running app loaded, empty if the process doesn't have this framework
+    char_t loaded_version[32];
+};
+
+struct ProbeReport {
+    ProbeVerdict verdict;
+    /// Return code of `hostfxr_resolve_frameworks_for_runtime_config`
+    int32_t resolve_result;
+    char_t hostfxr_version[32];
+    /// Version of Microsoft.NETCore.App running in the process, empty if runtime is not loaded yet
+    char_t loaded_runtime_version[32];
+    uint32_t installed_framework_count;
+    uint32_t framework_count;
+    ProbeFramework frameworks[PROBE_MAX_FRAMEWORKS];
+    /// `configProperties` that the running app doesn't have or has with another value, any of them fails the load
+    uint32_t different_property_count;
+};
+
+/// Kind of event in diagnostics ring, see `bootstrapper_drain_diagnostics`
+enum class DiagnosticKind : uint32_t {
+    /// Message written by hostfxr, e.g. why runtime config was rejected
+    HostFxrError,
+    /// Session couldn't be opened, `value` is hostfxr status code, message is runtime config path
+    SessionError,
+    /// Payload load finished, `value` is HRESULT of the runtime delegate, message is assembly path
+    Load,
+    /// Managed method couldn't be resolved, `value` is HRESULT of the runtime delegate, message is method name
+    InvokeError,
+    /// Injection of `LD_PRELOAD` mode finished, `value` is how long it waited for the runtime in milliseconds
+    Preload,
+    /// Watched payload was reloaded, `value` is number of previous builds that are still alive
+    Reload,
+    /// Worker started a job, `value` is how long it waited in microseconds, message is the scheduling it runs with
+    Schedule,
+    /// Dependencies of the payload were read ahead, value is the number of bytes, message is the payload
+    Prefetch,
+};
+
+struct DiagnosticEvent {
+    /// Position in the ring, gaps mean that events were overwritten before they were drained
+    uint64_t position;
+    /// Microseconds since Unix epoch
+    uint64_t timestamp_us;
+    DiagnosticKind kind;
+    InitializeResult result;
+    int64_t value;
+    /// Truncated to fit
+    char_t message[224];
+};
+
+/// Payload whose entry point was called in the process, see `bootstrapper_list_payloads`
+struct LoadedPayload {
+    /// FNV-1a of the assembly content, continued over type and method name, so it identifies the entry point
+    uint64_t key;
+    /// FNV-1a of the assembly content alone
+    uint64_t content_hash;
+    /// Microseconds since Unix epoch
+    uint64_t loaded_at_us;
+    /// How many injections of the same payload returned `AlreadyLoaded` since
+    uint32_t repeat_count;
+    /// Non-zero if the assembly was loaded from memory, `assembly_path` is empty then
+    uint32_t in_memory;
+    /// Truncated to fit
+    char_t assembly_path[256];
+    char_t type_name[128];
+    char_t method_name[128];
+};
+
+/// Keeps hostfxr context and runtime delegates alive between loads
+struct Session;
+
+/// Describes single payload of batched injection
+struct AssemblyDescriptor {
+    const char_t *assembly_path;
+    const char_t *type_name;
+    const char_t *method_name;
+};
+
+/// Shared memory command channel, see `bootstrapper_open_channel`
+struct Channel;
+
+/// Hot reload of payload, see `bootstrapper_watch_assembly`
+struct Watcher;
+
+extern "C" {
+
+/// Path to hostfxr that is loaded if none is mapped into process yet, `HOSTFXR_PATH` environment variable also works
+EXPORT void bootstrapper_set_hostfxr_path(const char_t *path);
+
+EXPORT void bootstrapper_get_last_report(LoadReport *report);
+
+EXPORT InitializeResult bootstrapper_open_session(const char_t *runtime_config_path, Session **out_session);
+
+/// Same as `bootstrapper_open_session`, but runtime config JSON is passed as bytes, so it doesn't have to be readable
+/// from the filesystem of the process
+EXPORT InitializeResult bootstrapper_open_session_bytes(
+    const void *runtime_config_bytes,
+    size_t runtime_config_size,
+    Session **out_session
+);
+
+EXPORT InitializeResult bootstrapper_session_load(
+    Session *session,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+);
+
+EXPORT InitializeResult bootstrapper_session_load_bytes(
+    Session *session,
+    const void *assembly_bytes,
+    size_t assembly_size,
+    const void *symbols_bytes,
+    size_t symbols_size,
+    const char_t *type_name,
+    const char_t *method_name
+);
+
+EXPORT void bootstrapper_close_session(Session *session);
+
+/// Calls `[UnmanagedCallersOnly] static int Method(IntPtr arg, int argSize)` of already loaded payload.
+/// Function pointer is resolved once and cached per (assembly, type, method), so warm calls cost a hash lookup
+/// and an indirect call. Pass `assembly_path == nullptr` for assemblies that were loaded from memory
+EXPORT InitializeResult bootstrapper_session_invoke(
+    Session *session,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    void *arg,
+    int32_t arg_size,
+    int32_t *result
+);
+
+/// Same as `bootstrapper_session_invoke` on process-wide session of `runtime_config_path`,
+/// so the cache survives between separate attaches of the injector
+EXPORT InitializeResult bootstrapper_invoke(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    void *arg,
+    int32_t arg_size,
+    int32_t *result
+);
+
+/// Loads the payload and calls its entry point, unless the same assembly content with the same entry point was already
+/// loaded by any of the load functions, then it returns `AlreadyLoaded` without even initializing runtime config
+EXPORT InitializeResult bootstrapper_load_assembly(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+);
+
+/// Copies up to `capacity` payloads that were loaded into the process, oldest first, and returns how many there are
+EXPORT size_t bootstrapper_list_payloads(LoadedPayload *payloads, size_t capacity);
+
+/// Copies up to `capacity` events that were recorded since the last drain and returns their count. Recording never
+/// blocks or allocates, so the oldest events are overwritten if nobody drains them, `dropped` receives how many were
+/// lost since the last drain
+EXPORT size_t bootstrapper_drain_diagnostics(DiagnosticEvent *events, size_t capacity, uint64_t *dropped);
+
+/// Checks which frameworks of `runtime_config_path` resolve in the environment of the process and whether they fit
+/// the runtime that is already running there, without initializing anything. Once the runtime is loaded, every
+/// framework the config references must be among frameworks of the running app and fit its version under the
+/// `rollForward` of the reference, the way hostfxr checks components, and its `configProperties` must match the
+/// app's. Returns `HostFxrLoadError` if hostfxr is not found, `Success` otherwise, the verdict is in `report`
+EXPORT InitializeResult bootstrapper_probe(const char_t *runtime_config_path, ProbeReport *report);
+
+/// Default scheduling of jobs that are started from now on, for the whole process. In `LD_PRELOAD` mode it's taken from
+/// `WORKER_NICE`, `WORKER_IDLE`, `WORKER_AFFINITY`, `WORKER_DEFER_CPU_PERCENT` and `WORKER_DEFER_MAX_MS` environment
+/// variables. To schedule a single job, use `bootstrapper_load_assembly_async_with_policy`
+EXPORT void bootstrapper_set_worker_policy(const WorkerPolicy *policy);
+
+/// Runs `bootstrapper_load_assembly` on bootstrapper-owned worker thread and returns ticket right away
+EXPORT uint64_t bootstrapper_load_assembly_async(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+);
+
+/// Same as `bootstrapper_load_assembly_async`, but the job runs with `policy` instead of the default one, which stays
+/// as it is for other jobs. `nullptr` means the default
+EXPORT uint64_t bootstrapper_load_assembly_async_with_policy(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    const WorkerPolicy *policy
+);
+
+/// Returns status of the ticket without blocking, `report` is filled unless it's `Unknown`. Once `Completed` is
+/// returned the ticket is forgotten and later calls return `Unknown`, as do tickets that completed long ago and were
+/// never read
+EXPORT TicketStatus bootstrapper_poll(uint64_t ticket, TicketReport *report);
+
+/// Same as `bootstrapper_poll`, but waits up to `timeout_ms` for completion. If several callers wait for the same
+/// ticket, one of them gets `Completed` and the rest `Unknown`
+EXPORT TicketStatus bootstrapper_wait(uint64_t ticket, uint32_t timeout_ms, TicketReport *report);
+
+EXPORT InitializeResult bootstrapper_load_assemblies(
+    const char_t *runtime_config_path,
+    const AssemblyDescriptor *descriptors,
+    size_t count,
+    InitializeResult *results
+);
+
+/// Hosts the app the way `dotnet app.dll args...` does (`argv[0]` is the app), but first loads `descriptors` into
+/// its runtime and calls their entry points, so patches are active at the first instruction of `Main`. The app is run
+/// only if every payload succeeded, `results[i]` receives status of `descriptors[i]` and `exit_code` receives the
+/// value returned by `hostfxr_run_app` once the app exits
+EXPORT InitializeResult bootstrapper_run_app(
+    int argc,
+    const char_t **argv,
+    const AssemblyDescriptor *descriptors,
+    size_t count,
+    InitializeResult *results,
+    int32_t *exit_code
+);
+
+#ifndef _WIN32
+/// Creates shared memory segment `/dev/shm/net-core-injector.<name>` holding single-producer/single-consumer ring of
+/// `slot_count` (power of two) messages up to `slot_size` bytes and starts thread that passes every message to
+/// `[UnmanagedCallersOnly] static int Method(IntPtr arg, int argSize)` of the payload via `bootstrapper_invoke`
+EXPORT Channel *bootstrapper_open_channel(
+    const char *name,
+    uint32_t slot_count,
+    uint32_t slot_size,
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+);
+
+/// Writes message from inside the process, returns `false` if the ring is full or message is too big
+EXPORT bool bootstrapper_channel_send(Channel *channel, const void *data, uint32_t size);
+
+EXPORT void bootstrapper_close_channel(Channel *channel);
+
+/// Loads payload into collectible context of `ReloadShim` (`shim_path`) and watches its file with inotify. Once it
+/// changes, `[UnmanagedCallersOnly] static void UnloadMethod()` of the previous build is called, its context is unloaded
+/// and the new build is loaded the same way, so patches can be iterated on without restart of the process.
+/// `unload_method_name` can be `nullptr` if the payload has nothing to undo
+EXPORT InitializeResult bootstrapper_watch_assembly(
+    const char_t *runtime_config_path,
+    const char_t *shim_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    const char_t *unload_method_name,
+    Watcher **out_watcher
+);
+
+/// Stops watching, the last loaded build stays in the process
+EXPORT void bootstrapper_unwatch_assembly(Watcher *watcher);
+
+/// Returns id of counters and latency histogram named `name` (UTF-8, e.g. patched method) in shared memory segment
+/// `/dev/shm/net-core-injector.stats-<pid>`, so they can be read by `stats` command without attaching. Same name
+/// always gets the same id, e.g. after hot reload of the payload. Returns -1 if segment can't be created or is full, or
+/// if `name` is longer than 111 bytes
+EXPORT int32_t bootstrapper_stats_register(const char *name);
+
+/// Counts one call of `id` that took `elapsed_ns`, it's a few relaxed atomic adds, so it can be called from patches
+EXPORT void bootstrapper_stats_record(int32_t id, uint64_t elapsed_ns);
+#endif
+
+}
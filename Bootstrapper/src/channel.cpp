@@ -0,0 +1,259 @@
+#include "bootstrapper.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+
+/// Layout of shared memory segment, `src/main.ts` writes into it directly, so keep them in sync
+struct ChannelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    /// Advisory positions, so a new producer or consumer can continue where the previous one stopped
+    std::atomic<uint64_t> producer_position;
+    std::atomic<uint64_t> consumer_position;
+    /// Non-zero while the consumer is blocked on the wake FIFO, only then producer has to write into it
+    std::atomic<uint32_t> consumer_waiting;
+    /// Process that created the segment, so a segment left behind by a crashed one can be replaced
+    uint32_t owner_pid;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(ChannelHeader) == 64);
+
+/// Slot of bounded queue: it's free for position `p` when `sequence == p` and holds message of position `p`
+/// when `sequence == p + 1`. Producer writes `sequence` last and every differing byte of it must be written
+/// before it matches, so even a non-atomic write from another process is never observed half-done
+struct ChannelSlot {
+    std::atomic<uint64_t> sequence;
+    uint32_t size;
+    uint32_t reserved;
+    uint8_t data[];
+};
+
+static constexpr uint32_t CHANNEL_MAGIC = 0x4349434e; /// "NCIC"
+static constexpr uint32_t CHANNEL_VERSION = 2;
+
+/// Producer in `src/main.ts` is plain file I/O and can't wake a futex, but it can write a byte into a FIFO
+static std::string getWakePath(const std::string &shm_name) {
+    return "/dev/shm" + shm_name + ".wake";
+}
+
+struct Channel {
+    std::string shm_name;
+    /// Read end for the consumer, it's opened for writing too, so it never sees EOF and `bootstrapper_channel_send`
+    /// and `bootstrapper_close_channel` can wake it through the same descriptor
+    int wake_fd = -1;
+    ChannelHeader *header = nullptr;
+    size_t mapping_size = 0;
+    std::atomic<bool> stop = false;
+    std::thread consumer;
+
+    std::basic_string<char_t> runtime_config_path;
+    std::basic_string<char_t> assembly_path;
+    std::basic_string<char_t> type_name;
+    std::basic_string<char_t> method_name;
+
+    ChannelSlot *slot(uint64_t position) const {
+        auto stride = sizeof(ChannelSlot) + header->slot_size;
+        auto offset = sizeof(ChannelHeader) + (position & (header->slot_count - 1)) * stride;
+        return reinterpret_cast<ChannelSlot *>(reinterpret_cast<uint8_t *>(header) + offset);
+    }
+
+    void wake() const {
+        char byte = 0;
+        /// Full pipe means the consumer has wakeups pending anyway
+        (void) !write(wake_fd, &byte, 1);
+    }
+
+    /// Blocks until a producer writes into the wake FIFO
+    void wait(uint64_t position) {
+        /// Producer publishes the slot and then checks `consumer_waiting`, consumer does it the other way around,
+        /// so at least one of them sees the other's write and a message is never left without wakeup
+        header->consumer_waiting.store(1, std::memory_order_seq_cst);
+        if (slot(position)->sequence.load(std::memory_order_seq_cst) != position + 1 &&
+            !stop.load(std::memory_order_relaxed)) {
+            pollfd fd{wake_fd, POLLIN, 0};
+            poll(&fd, 1, -1);
+        }
+        header->consumer_waiting.store(0, std::memory_order_relaxed);
+
+        char buffer[64];
+        while (read(wake_fd, buffer, sizeof(buffer)) > 0) {
+        }
+    }
+
+    void consume() {
+        auto position = header->consumer_position.load(std::memory_order_relaxed);
+        uint32_t spins = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto current = slot(position);
+            if (current->sequence.load(std::memory_order_acquire) != position + 1) {
+                /// Spin shortly after the last message since commands tend to come in bursts, then block, so an
+                /// idle channel costs no wakeups at all
+                if (++spins < 64) {
+                    std::this_thread::yield();
+                } else {
+                    wait(position);
+                    spins = 0;
+                }
+                continue;
+            }
+            spins = 0;
+
+            auto size = std::min(current->size, header->slot_size);
+            bootstrapper_invoke(runtime_config_path.c_str(), assembly_path.empty() ? nullptr : assembly_path.c_str(),
+                                type_name.c_str(), method_name.c_str(), current->data, (int32_t) size, nullptr);
+
+            current->sequence.store(position + header->slot_count, std::memory_order_release);
+            header->consumer_position.store(++position, std::memory_order_relaxed);
+        }
+    }
+};
+
+/// Segment whose creator is gone, e.g. crashed before `bootstrapper_close_channel`
+static bool isStale(const std::string &shm_name) {
+    int fd = shm_open(shm_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    uint32_t owner_pid = 0;
+    auto read = pread(fd, &owner_pid, sizeof(owner_pid), offsetof(ChannelHeader, owner_pid));
+    close(fd);
+    if (read != sizeof(owner_pid)) {
+        return false;
+    }
+    return owner_pid == 0 || (kill((pid_t) owner_pid, 0) != 0 && errno == ESRCH);
+}
+
+extern "C" EXPORT Channel *bootstrapper_open_channel(
+    const char *name,
+    uint32_t slot_count,
+    uint32_t slot_size,
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    if (strchr(name, '/') || slot_count == 0 || (slot_count & (slot_count - 1)) != 0 || slot_size == 0) {
+        return nullptr;
+    }
+
+    auto channel = new Channel;
+    channel->shm_name = std::string("/net-core-injector.") + name;
+    channel->mapping_size = sizeof(ChannelHeader) + (size_t) slot_count * (sizeof(ChannelSlot) + slot_size);
+
+    int fd = shm_open(channel->shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == EEXIST && isStale(channel->shm_name)) {
+        shm_unlink(channel->shm_name.c_str());
+        fd = shm_open(channel->shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) {
+        delete channel;
+        return nullptr;
+    }
+
+    /// Owner is written before the segment gets its size, so it's never seen without one
+    uint32_t owner_pid = (uint32_t) getpid();
+    if (pwrite(fd, &owner_pid, sizeof(owner_pid), offsetof(ChannelHeader, owner_pid)) != sizeof(owner_pid) ||
+        ftruncate(fd, (off_t) channel->mapping_size) != 0) {
+        close(fd);
+        shm_unlink(channel->shm_name.c_str());
+        delete channel;
+        return nullptr;
+    }
+
+    /// The segment is ours now, so is the FIFO next to it
+    auto wake_path = getWakePath(channel->shm_name);
+    unlink(wake_path.c_str());
+    if (mkfifo(wake_path.c_str(), 0600) != 0 ||
+        (channel->wake_fd = open(wake_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0) {
+        close(fd);
+        unlink(wake_path.c_str());
+        shm_unlink(channel->shm_name.c_str());
+        delete channel;
+        return nullptr;
+    }
+
+    auto mapping = mmap(nullptr, channel->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        close(channel->wake_fd);
+        unlink(wake_path.c_str());
+        shm_unlink(channel->shm_name.c_str());
+        delete channel;
+        return nullptr;
+    }
+
+    channel->header = static_cast<ChannelHeader *>(mapping);
+    channel->header->slot_count = slot_count;
+    channel->header->slot_size = slot_size;
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        channel->slot(i)->sequence.store(i, std::memory_order_relaxed);
+    }
+    channel->header->version = CHANNEL_VERSION;
+    std::atomic_ref(channel->header->magic).store(CHANNEL_MAGIC, std::memory_order_release);
+
+    channel->runtime_config_path = runtime_config_path;
+    channel->assembly_path = assembly_path ? assembly_path : std::basic_string<char_t>();
+    channel->type_name = type_name;
+    channel->method_name = method_name;
+
+    channel->consumer = std::thread([channel] {
+        channel->consume();
+    });
+
+    return channel;
+}
+
+extern "C" EXPORT bool bootstrapper_channel_send(Channel *channel, const void *data, uint32_t size) {
+    auto header = channel->header;
+    if (size > header->slot_size) {
+        return false;
+    }
+
+    auto position = header->producer_position.load(std::memory_order_relaxed);
+    auto slot = channel->slot(position);
+    if (slot->sequence.load(std::memory_order_acquire) != position) {
+        return false;
+    }
+
+    slot->size = size;
+    memcpy(slot->data, data, size);
+    slot->sequence.store(position + 1, std::memory_order_seq_cst);
+    header->producer_position.store(position + 1, std::memory_order_relaxed);
+    if (header->consumer_waiting.load(std::memory_order_seq_cst)) {
+        channel->wake();
+    }
+    return true;
+}
+
+extern "C" EXPORT void bootstrapper_close_channel(Channel *channel) {
+    if (!channel) {
+        return;
+    }
+
+    channel->stop = true;
+    channel->wake();
+    channel->consumer.join();
+
+    munmap(channel->header, channel->mapping_size);
+    close(channel->wake_fd);
+    unlink(getWakePath(channel->shm_name).c_str());
+    shm_unlink(channel->shm_name.c_str());
+
+    delete channel;
+}
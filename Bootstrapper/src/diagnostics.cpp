@@ -0,0 +1,119 @@
+#include "diagnostics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#ifdef _WIN32
+#define CHAR_T_FORMAT "%ls"
+#else
+#define CHAR_T_FORMAT "%s"
+#endif
+
+/// Must be power of two
+static constexpr uint64_t DIAGNOSTICS_CAPACITY = 256;
+
+/// Seqlock: `sequence` is odd while event of `position` is written and `2 * position + 2` once it's complete,
+/// so a reader detects both half-written and overwritten slots without taking locks
+struct DiagnosticSlot {
+    std::atomic<uint64_t> sequence;
+    DiagnosticEvent event;
+};
+
+static DiagnosticSlot slots[DIAGNOSTICS_CAPACITY];
+
+/// Next position to be written
+static std::atomic<uint64_t> head = 0;
+
+/// Readers are serialized between each other only, writers never wait for them
+static std::mutex drain_mutex;
+static uint64_t drained = 0;
+
+static const char *kindName(DiagnosticKind kind) {
+    switch (kind) {
+        case DiagnosticKind::HostFxrError:
+            return "HostFxrError";
+        case DiagnosticKind::SessionError:
+            return "SessionError";
+        case DiagnosticKind::Load:
+            return "Load";
+        case DiagnosticKind::InvokeError:
+            return "InvokeError";
+        case DiagnosticKind::Preload:
+            return "Preload";
+        case DiagnosticKind::Reload:
+            return "Reload";
+        case DiagnosticKind::Schedule:
+            return "Schedule";
+        case DiagnosticKind::Prefetch:
+            return "Prefetch";
+    }
+    return "Unknown";
+}
+
+void recordDiagnostic(DiagnosticKind kind, InitializeResult result, int64_t value, const char_t *message) {
+    static const bool verbose = std::getenv("BOOTSTRAPPER_VERBOSE") != nullptr;
+
+    auto position = head.fetch_add(1, std::memory_order_relaxed);
+    auto &slot = slots[position & (DIAGNOSTICS_CAPACITY - 1)];
+
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto &event = slot.event;
+    event.position = position;
+    event.timestamp_us = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    event.kind = kind;
+    event.result = result;
+    event.value = value;
+
+    size_t i = 0;
+    for (; message && message[i] && i < std::size(event.message) - 1; ++i) {
+        event.message[i] = message[i];
+    }
+    event.message[i] = 0;
+
+    slot.sequence.store(2 * position + 2, std::memory_order_release);
+
+    if (verbose) {
+        printf("[+] %s => %u (%lld) " CHAR_T_FORMAT "\n", kindName(kind), (uint32_t) result, (long long) value,
+               event.message);
+    }
+}
+
+extern "C" EXPORT size_t bootstrapper_drain_diagnostics(DiagnosticEvent *events, size_t capacity, uint64_t *dropped) {
+    std::lock_guard lock(drain_mutex);
+
+    auto end = head.load(std::memory_order_acquire);
+    auto position = std::max(drained, end > DIAGNOSTICS_CAPACITY ? end - DIAGNOSTICS_CAPACITY : 0);
+    uint64_t lost = position - drained;
+
+    size_t count = 0;
+    for (; position < end && count < capacity; ++position) {
+        auto &slot = slots[position & (DIAGNOSTICS_CAPACITY - 1)];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence < 2 * position + 2) {
+            /// Still being written, it's picked up by the next drain
+            break;
+        }
+
+        events[count] = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence != 2 * position + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            /// Overwritten by a newer event while we were behind
+            ++lost;
+            continue;
+        }
+        ++count;
+    }
+
+    drained = position;
+    if (dropped) {
+        *dropped = lost;
+    }
+    return count;
+}
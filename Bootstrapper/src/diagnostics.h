@@ -0,0 +1,7 @@
+#pragma once
+
+#include "bootstrapper.h"
+
+/// Appends event to the diagnostics ring, it's safe to call from any thread and never blocks.
+/// Event is also printed to stdout if `BOOTSTRAPPER_VERBOSE` environment variable is set
+void recordDiagnostic(DiagnosticKind kind, InitializeResult result, int64_t value, const char_t *message);
@@ -0,0 +1,525 @@
+/// Frida-free injector: makes the target `dlopen` the bootstrapper and submit the payload to its worker with
+/// `bootstrapper_load_assembly_async` by hijacking its main thread with ptrace, then polls the ticket. The hijacked
+/// thread never runs the runtime or the payload, so the app's main thread is held for milliseconds and can't
+/// deadlock waiting for itself. Only x86_64 Linux is supported
+
+#include "bootstrapper.h"
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Kernel-internal restart codes that are visible to ptrace while the thread is interrupted in a syscall
+static constexpr long ERESTART_RESTARTBLOCK = 516;
+
+/// Finds load address of the file that is mapped into `pid` at offset 0
+static uint64_t findRemoteBase(pid_t pid, const std::string &path) {
+    std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        std::istringstream fields(line);
+        std::string range, perms, offset, dev, inode, file;
+        fields >> range >> perms >> offset >> dev >> inode >> file;
+        if (file == path && std::strtoull(offset.c_str(), nullptr, 16) == 0) {
+            return std::strtoull(range.c_str(), nullptr, 16);
+        }
+    }
+    return 0;
+}
+
+/// Translates address of libc function in this process into address of the same function in `pid`
+static uint64_t findRemoteFunction(pid_t pid, void *local) {
+    Dl_info info{};
+    if (!dladdr(local, &info) || !info.dli_fname) {
+        return 0;
+    }
+
+    char path[PATH_MAX];
+    if (!realpath(info.dli_fname, path)) {
+        return 0;
+    }
+
+    auto remote_base = findRemoteBase(pid, path);
+    if (!remote_base) {
+        return 0;
+    }
+    return remote_base + ((uint64_t) local - (uint64_t) info.dli_fbase);
+}
+
+/// Path of the file mapped at `address` of `pid`, empty for anonymous memory
+static std::string findRemoteMapping(pid_t pid, uint64_t address) {
+    std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        std::istringstream fields(line);
+        std::string range, perms, offset, dev, inode, file;
+        fields >> range >> perms >> offset >> dev >> inode >> file;
+
+        auto dash = range.find('-');
+        auto begin = std::strtoull(range.c_str(), nullptr, 16);
+        auto end = std::strtoull(range.c_str() + dash + 1, nullptr, 16);
+        if (address >= begin && address < end) {
+            return file;
+        }
+    }
+    return {};
+}
+
+/// Entry point of the main executable, it never runs again, so it's safe to put a trampoline there
+static uint64_t findEntryPoint(pid_t pid) {
+    std::ifstream auxv("/proc/" + std::to_string(pid) + "/auxv", std::ios::binary);
+    Elf64_auxv_t entry;
+    while (auxv.read(reinterpret_cast<char *>(&entry), sizeof(entry))) {
+        if (entry.a_type == AT_ENTRY) {
+            return entry.a_un.a_val;
+        }
+        if (entry.a_type == AT_NULL) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/// This class helps to run code on a stopped thread of another process
+class RemoteThread {
+public:
+    explicit RemoteThread(pid_t pid) : pid(pid) {}
+
+    bool attach() {
+        if (ptrace(PTRACE_SEIZE, pid, nullptr, nullptr) != 0) {
+            perror("ptrace(PTRACE_SEIZE)");
+            return false;
+        }
+        attached = true;
+
+        if (ptrace(PTRACE_INTERRUPT, pid, nullptr, nullptr) != 0 || !waitForStop(false)) {
+            return false;
+        }
+
+        if (ptrace(PTRACE_GETREGS, pid, nullptr, &saved) != 0) {
+            perror("ptrace(PTRACE_GETREGS)");
+            return false;
+        }
+        return true;
+    }
+
+    /// Thread blocked in a syscall isn't in the middle of `malloc` or in cooperative managed code, and outside of the
+    /// dynamic loader it doesn't hold its lock, so `dlopen` and a short call can run on top of it
+    bool isAtSafePoint() const {
+        if ((long) saved.orig_rax < 0) {
+            return false;
+        }
+
+        auto file = findRemoteMapping(pid, saved.rip);
+        auto slash = file.rfind('/');
+        return !file.empty() && file.compare(slash == std::string::npos ? 0 : slash + 1, 3, "ld-") != 0;
+    }
+
+    bool prepare() {
+        trampoline = findEntryPoint(pid);
+        if (!trampoline) {
+            fprintf(stderr, "failed to find entry point of %d\n", pid);
+            return false;
+        }
+
+        /// syscall; int3
+        errno = 0;
+        saved_code = ptrace(PTRACE_PEEKTEXT, pid, trampoline, nullptr);
+        if (errno != 0) {
+            perror("ptrace(PTRACE_PEEKTEXT)");
+            return false;
+        }
+        auto code = (saved_code & ~0xffffffL) | 0xcc050fL;
+        if (ptrace(PTRACE_POKETEXT, pid, trampoline, code) != 0) {
+            perror("ptrace(PTRACE_POKETEXT)");
+            return false;
+        }
+        patched = true;
+
+        return true;
+    }
+
+    void detach() {
+        if (patched) {
+            ptrace(PTRACE_POKETEXT, pid, trampoline, saved_code);
+        }
+
+        if (attached) {
+            auto regs = saved;
+            /// Restart block of interrupted syscall may be overwritten by our calls, so report EINTR instead
+            if ((long) regs.orig_rax >= 0 && (long) regs.rax == -ERESTART_RESTARTBLOCK) {
+                regs.rax = (uint64_t) -EINTR;
+                regs.orig_rax = (uint64_t) -1;
+            }
+            ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+            ptrace(PTRACE_DETACH, pid, nullptr, nullptr);
+        }
+        attached = patched = false;
+    }
+
+    bool syscall(long number, std::initializer_list<uint64_t> args, uint64_t &result) {
+        auto regs = prepareRegisters();
+        regs.rip = trampoline;
+        regs.rax = number;
+
+        decltype(regs.rdi) *registers[] = {&regs.rdi, &regs.rsi, &regs.rdx, &regs.r10, &regs.r8, &regs.r9};
+        size_t i = 0;
+        for (auto arg: args) {
+            *registers[i++] = arg;
+        }
+
+        return run(regs, result);
+    }
+
+    bool call(uint64_t function, std::initializer_list<uint64_t> args, uint64_t &result) {
+        auto regs = prepareRegisters();
+        regs.rip = function;
+        regs.rax = 0;
+
+        decltype(regs.rdi) *registers[] = {&regs.rdi, &regs.rsi, &regs.rdx, &regs.rcx, &regs.r8, &regs.r9};
+        size_t i = 0;
+        for (auto arg: args) {
+            *registers[i++] = arg;
+        }
+
+        /// Function returns to `int3` right after `syscall` of trampoline
+        regs.rsp -= sizeof(uint64_t);
+        uint64_t return_address = trampoline + 2;
+        if (!write(regs.rsp, &return_address, sizeof(return_address))) {
+            return false;
+        }
+
+        return run(regs, result);
+    }
+
+    bool write(uint64_t address, const void *data, size_t size) {
+        iovec local{const_cast<void *>(data), size};
+        iovec remote{reinterpret_cast<void *>(address), size};
+        if (process_vm_writev(pid, &local, 1, &remote, 1, 0) != (ssize_t) size) {
+            perror("process_vm_writev");
+            return false;
+        }
+        return true;
+    }
+
+    bool read(uint64_t address, void *data, size_t size) {
+        iovec local{data, size};
+        iovec remote{reinterpret_cast<void *>(address), size};
+        if (process_vm_readv(pid, &local, 1, &remote, 1, 0) != (ssize_t) size) {
+            perror("process_vm_readv");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    /// Skips the red zone and aligns stack as it must be right before `call` instruction
+    user_regs_struct prepareRegisters() const {
+        auto regs = saved;
+        regs.rsp = (saved.rsp - 1024) & ~0xfUL;
+        /// Don't let kernel restart the interrupted syscall on top of our registers
+        regs.orig_rax = (uint64_t) -1;
+        return regs;
+    }
+
+    bool run(user_regs_struct &regs, uint64_t &result) {
+        if (ptrace(PTRACE_SETREGS, pid, nullptr, &regs) != 0) {
+            perror("ptrace(PTRACE_SETREGS)");
+            return false;
+        }
+
+        if (ptrace(PTRACE_CONT, pid, nullptr, nullptr) != 0 || !waitForStop(true)) {
+            return false;
+        }
+
+        if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs) != 0) {
+            perror("ptrace(PTRACE_GETREGS)");
+            return false;
+        }
+
+        result = regs.rax;
+        return true;
+    }
+
+    /// Waits for either `PTRACE_INTERRUPT` or our `int3`, other signals (e.g. GC suspension of .NET) are passed through
+    bool waitForStop(bool trap) {
+        while (true) {
+            int status;
+            if (waitpid(pid, &status, __WALL) < 0) {
+                perror("waitpid");
+                return false;
+            }
+
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                fprintf(stderr, "process %d exited\n", pid);
+                attached = patched = false;
+                return false;
+            }
+
+            if (!WIFSTOPPED(status)) {
+                continue;
+            }
+
+            auto signal = WSTOPSIG(status);
+            bool event_stop = (status >> 16) == PTRACE_EVENT_STOP;
+            if (!trap && event_stop) {
+                return true;
+            }
+            if (trap && signal == SIGTRAP && !event_stop) {
+                return true;
+            }
+
+            auto pass = event_stop ? 0 : signal;
+            if (trap && signal != SIGTRAP && !event_stop) {
+                fprintf(stderr, "process %d received signal %d during remote call\n", pid, signal);
+                if (signal == SIGSEGV || signal == SIGBUS || signal == SIGILL) {
+                    return false;
+                }
+            }
+            ptrace(PTRACE_CONT, pid, nullptr, (void *) (long) pass);
+        }
+    }
+
+    pid_t pid;
+    bool attached = false;
+    bool patched = false;
+    user_regs_struct saved{};
+    uint64_t trampoline = 0;
+    long saved_code = 0;
+};
+
+/// Copies all strings into single remote buffer, returns their remote addresses
+static bool writeStrings(RemoteThread &thread, uint64_t buffer, const std::vector<std::string> &strings,
+                         std::vector<uint64_t> &addresses) {
+    uint64_t offset = 0;
+    for (const auto &string: strings) {
+        if (!thread.write(buffer + offset, string.c_str(), string.size() + 1)) {
+            return false;
+        }
+        addresses.push_back(buffer + offset);
+        offset += string.size() + 1;
+    }
+    return true;
+}
+
+/// Stops the main thread until it's stopped at a safe point or `timeout` is over. `stopped` receives the time of
+/// the stop that is kept, time of discarded ones is added to `held`
+static bool attachAtSafePoint(RemoteThread &thread, std::chrono::milliseconds timeout,
+                              std::chrono::steady_clock::time_point &stopped, std::chrono::steady_clock::duration &held) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        auto attached = thread.attach();
+        if (attached && thread.isAtSafePoint()) {
+            stopped = start;
+            return thread.prepare();
+        }
+        thread.detach();
+        stopped = std::chrono::steady_clock::now();
+        held += stopped - start;
+
+        if (!attached) {
+            return false;
+        }
+        if (stopped > deadline) {
+            fprintf(stderr, "main thread never stopped in a syscall outside of the dynamic loader\n");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/// Remote state that outlives a single attach
+struct Injection {
+    uint64_t buffer = 0;
+    size_t size = 0;
+    uint64_t report = 0;
+    uint64_t poll = 0;
+    uint64_t ticket = 0;
+};
+
+/// `dlopen`s the bootstrapper and submits the payload to its worker, `TicketReport` buffer stays mapped for polling
+static bool submit(RemoteThread &thread, pid_t pid, const std::vector<std::string> &strings, Injection &injection) {
+    auto remote_dlopen = findRemoteFunction(pid, (void *) dlopen);
+    auto remote_dlsym = findRemoteFunction(pid, (void *) dlsym);
+    if (!remote_dlopen || !remote_dlsym) {
+        fprintf(stderr, "failed to find dlopen/dlsym in %d, it must use the same libc as injector\n", pid);
+        return false;
+    }
+
+    injection.size = sizeof(TicketReport);
+    for (const auto &string: strings) {
+        injection.size += string.size() + 1;
+    }
+
+    uint64_t buffer;
+    if (!thread.syscall(SYS_mmap, {0, injection.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                                   (uint64_t) -1, 0}, buffer)) {
+        return false;
+    }
+    if ((int64_t) buffer < 0 && (int64_t) buffer > -4096) {
+        fprintf(stderr, "remote mmap failed: %s\n", strerror((int) -(int64_t) buffer));
+        return false;
+    }
+    injection.buffer = buffer;
+    /// mmap is page-aligned, so the report at its start is aligned as well
+    injection.report = buffer;
+
+    std::vector<uint64_t> addresses;
+    uint64_t handle = 0;
+    uint64_t load = 0;
+    if (!writeStrings(thread, buffer + sizeof(TicketReport), strings, addresses)) {
+        return false;
+    }
+    if (!thread.call(remote_dlopen, {addresses[0], RTLD_NOW}, handle) || !handle) {
+        fprintf(stderr, "remote dlopen(%s) failed\n", strings[0].c_str());
+        return false;
+    }
+    if (!thread.call(remote_dlsym, {handle, addresses[1]}, load) || !load ||
+        !thread.call(remote_dlsym, {handle, addresses[2]}, injection.poll) || !injection.poll) {
+        fprintf(stderr, "remote dlsym(%s) failed, bootstrapper is too old\n", strings[1].c_str());
+        return false;
+    }
+
+    /// Strings are copied by the bootstrapper, the worker thread does the rest
+    return thread.call(load, {addresses[3], addresses[4], addresses[5], addresses[6]}, injection.ticket) &&
+           injection.ticket != 0;
+}
+
+static void releaseBuffer(RemoteThread &thread, const Injection &injection) {
+    uint64_t unused;
+    if (injection.buffer) {
+        thread.syscall(SYS_munmap, {injection.buffer, injection.size}, unused);
+    }
+}
+
+static void printReport(const TicketReport &report) {
+    const char *phases[] = {"ModuleLookup", "InitializeRuntimeConfig", "GetRuntimeDelegate", "Prefetch", "LoadAssembly",
+                            "EntryPoint"};
+    static_assert(std::size(phases) == (size_t) Phase::Count);
+
+    printf("[*] ticket waited %.3f ms for worker\n", (double) report.queue_ns / 1e6);
+    for (size_t i = 0; i < (size_t) Phase::Count; ++i) {
+        printf("[*]   %-24s %10.3f ms\n", phases[i], (double) report.load.phases[i].duration_ns / 1e6);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 7 && argc != 8) {
+        fprintf(stderr, "usage: %s <pid> <bootstrapper> <runtime_config_path> <assembly_path> <type_name> <method_name> "
+                        "[timeout_ms]\n", argv[0]);
+        return 1;
+    }
+
+    auto pid = (pid_t) std::strtol(argv[1], nullptr, 10);
+    std::chrono::milliseconds timeout(argc == 8 ? std::strtoul(argv[7], nullptr, 10) : 60000);
+
+    /// Target may have different working directory
+    auto resolve = [](const char *path, std::string &resolved) {
+        char buffer[PATH_MAX];
+        if (!realpath(path, buffer)) {
+            perror(path);
+            return false;
+        }
+        resolved = buffer;
+        return true;
+    };
+
+    std::string bootstrapper, runtime_config_path, assembly_path;
+    if (!resolve(argv[2], bootstrapper) || !resolve(argv[3], runtime_config_path) || !resolve(argv[4], assembly_path)) {
+        return 1;
+    }
+
+    std::vector<std::string> strings{
+        bootstrapper,
+        "bootstrapper_load_assembly_async",
+        "bootstrapper_poll",
+        runtime_config_path,
+        assembly_path,
+        argv[5],
+        argv[6],
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point stopped = start;
+    std::chrono::steady_clock::duration held{};
+
+    RemoteThread thread(pid);
+    Injection injection;
+    auto submitted = attachAtSafePoint(thread, timeout, stopped, held) && submit(thread, pid, strings, injection);
+    if (!submitted) {
+        releaseBuffer(thread, injection);
+    }
+    thread.detach();
+    held += std::chrono::steady_clock::now() - stopped;
+    if (!submitted) {
+        return 1;
+    }
+
+    auto submit_time = std::chrono::steady_clock::now() - start;
+    printf("[*] bootstrapper_load_assembly_async() => ticket %llu\n", (unsigned long long) injection.ticket);
+
+    /// Main thread runs freely between polls, every poll holds it only for `bootstrapper_poll`
+    TicketReport report{};
+    auto status = TicketStatus::Unknown;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (status != TicketStatus::Completed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        uint64_t ret = 0;
+        auto polled = attachAtSafePoint(thread, timeout, stopped, held) &&
+                      thread.call(injection.poll, {injection.ticket, injection.report}, ret);
+        status = (TicketStatus) ret;
+        if (polled && status == TicketStatus::Completed) {
+            thread.read(injection.report, &report, sizeof(report));
+            releaseBuffer(thread, injection);
+        }
+        thread.detach();
+        held += std::chrono::steady_clock::now() - stopped;
+        if (!polled) {
+            return 1;
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto ms = [](std::chrono::steady_clock::duration duration) {
+        return (double) std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.0;
+    };
+    printf("[*] attach-to-submit took %.3f ms, attach-to-completed %.3f ms, main thread held for %.3f ms\n",
+           ms(submit_time), ms(elapsed), ms(held));
+
+    if (status != TicketStatus::Completed) {
+        fprintf(stderr, "ticket %llu didn't complete in %lld ms\n", (unsigned long long) injection.ticket,
+                (long long) timeout.count());
+        return 1;
+    }
+
+    auto result = report.load.result;
+    printf("[*] bootstrapper_load_assembly() => %u (InitializeResult::%s)\n", (uint32_t) result,
+           resultName(result));
+    printReport(report);
+
+    /// Payload that is already there is what a repeated rollout expects
+    return result == InitializeResult::Success || result == InitializeResult::AlreadyLoaded ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/// Just enough of JSON to walk `.deps.json` and `.runtimeconfig.json`: objects and arrays are visited element by
+/// element, whatever the caller doesn't need is skipped. Comments are skipped too, hostfxr accepts them in runtime config
+class JsonReader {
+public:
+    explicit JsonReader(const std::string &json) : json(json) {}
+
+    /// Calls `member(key)` for every member of the object at the current position, `member` must consume the value
+    template<typename F>
+    bool readObject(F &&member) {
+        if (!consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return true;
+        }
+
+        do {
+            std::string key;
+            if (!readString(key) || !consume(':') || !member(key)) {
+                return false;
+            }
+        } while (consume(','));
+
+        return consume('}');
+    }
+
+    /// Calls `element()` for every element of the array at the current position, `element` must consume it
+    template<typename F>
+    bool readArray(F &&element) {
+        if (!consume('[')) {
+            return false;
+        }
+        if (consume(']')) {
+            return true;
+        }
+
+        do {
+            if (!element()) {
+                return false;
+            }
+        } while (consume(','));
+
+        return consume(']');
+    }
+
+    /// Non-ASCII `\u` escapes don't occur in paths and names, they are replaced with '?'
+    bool readString(std::string &str) {
+        if (!consume('"')) {
+            return false;
+        }
+
+        while (position < json.size()) {
+            auto c = json[position++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                str += c;
+                continue;
+            }
+            if (position >= json.size()) {
+                return false;
+            }
+
+            auto escaped = json[position++];
+            switch (escaped) {
+                case 'n':
+                    str += '\n';
+                    break;
+                case 't':
+                    str += '\t';
+                    break;
+                case 'u': {
+                    if (position + 4 > json.size()) {
+                        return false;
+                    }
+                    auto code = std::strtoul(json.substr(position, 4).c_str(), nullptr, 16);
+                    str += code < 0x80 ? (char) code : '?';
+                    position += 4;
+                    break;
+                }
+                default:
+                    /// `\"`, `\\` and `\/`, rest of escapes can't appear in a path
+                    str += escaped;
+                    break;
+            }
+        }
+        return false;
+    }
+
+    /// Number, `true`, `false` or `null` as it's written
+    bool readLiteral(std::string &literal) {
+        skipWhitespace();
+        auto end = json.find_first_of(",}] \t\r\n/", position);
+        end = end == std::string::npos ? json.size() : end;
+        if (end == position || strchr("{[\"", json[position])) {
+            return false;
+        }
+
+        literal = json.substr(position, end - position);
+        position = end;
+        return true;
+    }
+
+    bool skipValue() {
+        skipWhitespace();
+        if (position >= json.size()) {
+            return false;
+        }
+
+        switch (json[position]) {
+            case '{':
+                return readObject([&](const std::string &) {
+                    return skipValue();
+                });
+            case '[':
+                return readArray([&] {
+                    return skipValue();
+                });
+            case '"': {
+                std::string unused;
+                return readString(unused);
+            }
+            default: {
+                std::string unused;
+                return readLiteral(unused);
+            }
+        }
+    }
+
+private:
+    void skipWhitespace() {
+        while (position < json.size()) {
+            if (json[position] && strchr(" \t\r\n", json[position])) {
+                ++position;
+            } else if (json.compare(position, 2, "//") == 0) {
+                auto end = json.find('\n', position);
+                position = end == std::string::npos ? json.size() : end;
+            } else if (json.compare(position, 2, "/*") == 0) {
+                auto end = json.find("*/", position + 2);
+                position = end == std::string::npos ? json.size() : end + 2;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (position < json.size() && json[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    const std::string &json;
+    size_t position = 0;
+};
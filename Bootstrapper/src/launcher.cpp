@@ -0,0 +1,131 @@
+/// Starts .NET app the way `dotnet app.dll` does, but with payloads loaded into its runtime before `Main` runs,
+/// so there is nothing to wait for and no call of the app goes unpatched
+
+#include "bootstrapper.h"
+#include "text.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define CHAR_T_FORMAT "%ls"
+#else
+#define CHAR_T_FORMAT "%s"
+#endif
+
+/// Finds `<dotnet_root>/host/fxr/<latest version>/` hostfxr the way `nethost` does for framework-dependent apps
+static std::filesystem::path findHostFxr() {
+#ifdef _WIN32
+    auto libraryName = "hostfxr.dll";
+    auto root = _wgetenv(L"DOTNET_ROOT");
+    std::vector<std::filesystem::path> roots{L"C:\\Program Files\\dotnet"};
+#else
+    auto libraryName = "libhostfxr.so";
+    auto root = std::getenv("DOTNET_ROOT");
+    std::vector<std::filesystem::path> roots{"/usr/share/dotnet", "/usr/lib/dotnet", "/usr/local/share/dotnet"};
+#endif
+    if (root) {
+        roots.insert(roots.begin(), root);
+    }
+
+    for (const auto &dotnet_root: roots) {
+        std::error_code error;
+        std::filesystem::path latest;
+        for (const auto &entry: std::filesystem::directory_iterator(dotnet_root / "host" / "fxr", error)) {
+            auto library = entry.path() / libraryName;
+            if (std::filesystem::exists(library, error) &&
+                (latest.empty() || parseVersion(entry.path().filename().c_str()) >
+                                   parseVersion(latest.parent_path().filename().c_str()))) {
+                latest = library;
+            }
+        }
+        if (!latest.empty()) {
+            return latest;
+        }
+    }
+
+    return {};
+}
+
+static int usage(const char_t *launcher) {
+    fprintf(stderr, "usage: " CHAR_T_FORMAT " [--hostfxr <path>] "
+                    "--payload <assembly_path> <type_name> <method_name> [--payload ...] "
+                    "[--] <app.dll> [app arguments...]\n", launcher);
+    return 1;
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+    std::filesystem::path hostfxr;
+    std::vector<std::basic_string<char_t>> payloads;
+
+    int i = 1;
+    for (; i < argc; ++i) {
+        if (equalsAscii(argv[i], "--hostfxr") && i + 1 < argc) {
+            hostfxr = argv[++i];
+        } else if (equalsAscii(argv[i], "--payload") && i + 3 < argc) {
+            /// Runtime requires full path of component assembly
+            payloads.push_back(std::filesystem::absolute(argv[i + 1]).native());
+            payloads.emplace_back(argv[i + 2]);
+            payloads.emplace_back(argv[i + 3]);
+            i += 3;
+        } else if (equalsAscii(argv[i], "--")) {
+            ++i;
+            break;
+        } else {
+            break;
+        }
+    }
+
+    if (i == argc || payloads.empty()) {
+        return usage(argv[0]);
+    }
+
+    /// `HOSTFXR_PATH` is still checked by the bootstrapper if nothing is found here
+    if (hostfxr.empty()) {
+        hostfxr = findHostFxr();
+    }
+    if (!hostfxr.empty()) {
+        bootstrapper_set_hostfxr_path(hostfxr.c_str());
+    }
+
+    std::vector<AssemblyDescriptor> descriptors;
+    for (size_t payload = 0; payload < payloads.size(); payload += 3) {
+        descriptors.push_back({payloads[payload].c_str(), payloads[payload + 1].c_str(), payloads[payload + 2].c_str()});
+    }
+    std::vector<InitializeResult> results(descriptors.size(), InitializeResult::Success);
+
+    /// App sees its own path as the first argument, as if it were started with `dotnet`
+    int32_t exit_code = 1;
+    auto ret = bootstrapper_run_app(argc - i, const_cast<const char_t **>(argv + i), descriptors.data(),
+                                    descriptors.size(), results.data(), &exit_code);
+    if (ret != InitializeResult::Success) {
+        fprintf(stderr, "[-] bootstrapper_run_app() => %u (InitializeResult::%s)\n", (uint32_t) ret, resultName(ret));
+        for (size_t payload = 0; payload < descriptors.size(); ++payload) {
+            fprintf(stderr, "[-]   " CHAR_T_FORMAT " => %s\n", descriptors[payload].assembly_path,
+                    resultName(results[payload]));
+        }
+
+        /// hostfxr explains why the app couldn't be started, e.g. missing framework, or at least returns status code
+        DiagnosticEvent events[16];
+        auto events_count = bootstrapper_drain_diagnostics(events, std::size(events), nullptr);
+        for (size_t event = 0; event < events_count; ++event) {
+            if (events[event].kind == DiagnosticKind::HostFxrError) {
+                fprintf(stderr, "[-]   " CHAR_T_FORMAT "\n", events[event].message);
+            } else if (events[event].kind == DiagnosticKind::SessionError) {
+                fprintf(stderr, "[-]   hostfxr returned 0x%08x for " CHAR_T_FORMAT "\n", (uint32_t) events[event].value,
+                        events[event].message);
+            }
+        }
+        return 1;
+    }
+
+    return exit_code;
+}
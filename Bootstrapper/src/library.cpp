@@ -1,20 +1,68 @@
 #ifdef _WIN32
-#define EXPORT __declspec(dllexport)
 #include <windows.h>
+#include <psapi.h>
 #else
-#define EXPORT [[gnu::visibility("default")]]
 #include <dlfcn.h>
-#include <thread>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#include "bootstrapper.h"
+#include "diagnostics.h"
+#include "json.h"
+#include "prefetch.h"
+#include "text.h"
+#ifndef _WIN32
+#include "preload.h"
 #endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 /// This class helps to manage shared libraries
 class Module {
 public:
+    /// Returns handle of library that is already mapped into process, so another copy of it is never loaded
     static void *getBaseAddress(const char *library) {
 #ifdef _WIN32
         auto base = GetModuleHandleA(library);
 #else
-        auto base = dlopen(library, RTLD_LAZY);
+        auto path = getPath(library);
+        auto base = path.empty() ? nullptr : dlopen(path.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+#endif
+        return reinterpret_cast<void *>(base);
+    }
+
+    /// Loads library from explicit path
+    static void *load(const char_t *path) {
+#ifdef _WIN32
+        auto base = LoadLibraryW(path);
+#else
+        auto base = dlopen(path, RTLD_LAZY);
 #endif
         return reinterpret_cast<void *>(base);
     }
@@ -32,113 +80,1769 @@ public:
     static T getFunctionByName(void *module, const char *name) {
         return reinterpret_cast<T>(getExportByName(module, name));
     }
+
+    /// Full path of library by its handle
+    static std::basic_string<char_t> getModulePath(void *module) {
+#ifdef _WIN32
+        wchar_t path[MAX_PATH];
+        auto len = GetModuleFileNameW((HMODULE) module, path, MAX_PATH);
+        return std::basic_string<char_t>(path, len);
+#else
+        link_map *map = nullptr;
+        if (dlinfo(module, RTLD_DI_LINKMAP, &map) != 0 || !map->l_name) {
+            return {};
+        }
+        return map->l_name;
+#endif
+    }
+
+#ifndef _WIN32
+    /// Finds full path of mapped library by its file name, e.g. hostfxr from non-standard `DOTNET_ROOT`
+    static std::string getPath(const char *library) {
+        struct Search {
+            const char *library;
+            std::string path;
+        } search{library, {}};
+
+        dl_iterate_phdr([](dl_phdr_info *info, size_t, void *data) -> int {
+            auto search = static_cast<Search *>(data);
+            auto slash = strrchr(info->dlpi_name, '/');
+            auto name = slash ? slash + 1 : info->dlpi_name;
+            if (strcmp(name, search->library) != 0) {
+                return 0;
+            }
+            search->path = info->dlpi_name;
+            return 1;
+        }, &search);
+
+        return search.path;
+    }
+#endif
 };
 
-#include <hostfxr.h>
-#include <coreclr_delegates.h>
-
-/// This enums represents possible errors to hide it from others
-/// useful for debugging
-enum class InitializeResult : uint32_t {
-    Success,
-    HostFxrLoadError,
-    InitializeRuntimeConfigError,
-    GetRuntimeDelegateError,
-    EntryPointError,
+static std::mutex report_mutex;
+static LoadReport last_report;
+/// Report of the load running on this thread, `last_report` is a copy of the one that made progress last, so a load
+/// that runs concurrently can't mix its phases into it
+static thread_local LoadReport thread_report;
+
+/// Resident set size of current process in bytes
+static int64_t getResidentSetSize() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return (int64_t) counters.WorkingSetSize;
+#else
+    /// `/proc/self/statm` is "size resident shared ..." in pages
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    char buffer[128];
+    auto len = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    buffer[len] = '\0';
+
+    char *resident = nullptr;
+    std::strtoll(buffer, &resident, 10);
+    return std::strtoll(resident, nullptr, 10) * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/// Measures monotonic duration and RSS delta of the enclosing scope into the last report
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase)
+        : phase(phase), rss(getResidentSetSize()), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer() {
+        auto duration = std::chrono::steady_clock::now() - start;
+        PhaseReport report{
+            (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+            getResidentSetSize() - rss,
+        };
+
+        thread_report.phases[(size_t) phase] = report;
+        std::lock_guard lock(report_mutex);
+        last_report = thread_report;
+    }
+
+private:
+    Phase phase;
+    int64_t rss;
+    std::chrono::steady_clock::time_point start;
 };
 
-extern "C" EXPORT InitializeResult bootstrapper_load_assembly(
-    const char_t *runtime_config_path,
-    const char_t *assembly_path,
-    const char_t *type_name,
-    const char_t *method_name
-) {
-    /// Get module base address
+/// Clears phases starting from `first` before they are measured again
+static void resetReport(Phase first) {
+    for (auto i = (size_t) first; i < (size_t) Phase::Count; ++i) {
+        thread_report.phases[i] = {};
+    }
+    if (first <= Phase::Prefetch) {
+        thread_report.prefetch_files = 0;
+        thread_report.prefetch_bytes = 0;
+        thread_report.prefetch_ns = 0;
+    }
+    std::lock_guard lock(report_mutex);
+    last_report = thread_report;
+}
+
+static void setReportPrefetch(const PrefetchResult &prefetch) {
+    thread_report.prefetch_files = prefetch.files;
+    thread_report.prefetch_bytes = prefetch.bytes;
+    thread_report.prefetch_ns = prefetch.wall_ns;
+    std::lock_guard lock(report_mutex);
+    last_report = thread_report;
+}
+
+static InitializeResult setReportResult(InitializeResult result) {
+    thread_report.result = result;
+    std::lock_guard lock(report_mutex);
+    last_report = thread_report;
+    return result;
+}
+
+extern "C" EXPORT void bootstrapper_get_last_report(LoadReport *report) {
+    std::lock_guard lock(report_mutex);
+    *report = last_report;
+}
+
+static std::mutex hostfxr_mutex;
+
+/// Explicit path to hostfxr, used only if it isn't mapped into process
+static std::basic_string<char_t> hostfxr_path;
+
+extern "C" EXPORT void bootstrapper_set_hostfxr_path(const char_t *path) {
+    std::lock_guard lock(hostfxr_mutex);
+    hostfxr_path = path ? path : std::basic_string<char_t>();
+}
+
+/// Exports of hostfxr that are resolved only once per process
+struct HostFxr {
+    void *module = nullptr;
+    hostfxr_initialize_for_runtime_config_fn initialize_for_runtime_config = nullptr;
+    hostfxr_get_runtime_delegate_fn get_runtime_delegate = nullptr;
+    hostfxr_close_fn close = nullptr;
+    /// Optional, these are missing in older hostfxr
+    hostfxr_set_error_writer_fn set_error_writer = nullptr;
+    hostfxr_get_dotnet_environment_info_fn get_dotnet_environment_info = nullptr;
+    hostfxr_resolve_frameworks_for_runtime_config_fn resolve_frameworks_for_runtime_config = nullptr;
+    hostfxr_get_runtime_property_value_fn get_runtime_property_value = nullptr;
+    /// Used only by `bootstrapper_run_app`
+    hostfxr_initialize_for_dotnet_command_line_fn initialize_for_dotnet_command_line = nullptr;
+    hostfxr_run_app_fn run_app = nullptr;
+
+    /// Returns the cached export table or `nullptr` if hostfxr is not loaded yet
+    static const HostFxr *get() {
+        static HostFxr instance;
+
+        std::lock_guard lock(hostfxr_mutex);
+        if (instance.module) {
+            return &instance;
+        }
+
+        /// Prefer hostfxr that is already mapped, it's the one the runtime was started with
 #ifdef _WIN32
-    auto libraryName = "hostfxr.dll";
+        auto libraryName = "hostfxr.dll";
+        auto pathVariable = _wgetenv(L"HOSTFXR_PATH");
 #else
-    auto libraryName = "libhostfxr.so";
+        auto libraryName = "libhostfxr.so";
+        auto pathVariable = std::getenv("HOSTFXR_PATH");
 #endif
-    void *module = Module::getBaseAddress(libraryName);
-    if (!module) {
-        return InitializeResult::HostFxrLoadError;
+        void *module = Module::getBaseAddress(libraryName);
+        if (!module && hostfxr_path.empty() && pathVariable) {
+            hostfxr_path = pathVariable;
+        }
+        if (!module && !hostfxr_path.empty()) {
+            module = Module::load(hostfxr_path.c_str());
+        }
+        if (!module) {
+            return nullptr;
+        }
+
+        /// Obtaining useful exports
+        HostFxr hostfxr;
+        hostfxr.initialize_for_runtime_config =
+            Module::getFunctionByName<hostfxr_initialize_for_runtime_config_fn>(module, "hostfxr_initialize_for_runtime_config");
+
+        hostfxr.get_runtime_delegate =
+            Module::getFunctionByName<hostfxr_get_runtime_delegate_fn>(module, "hostfxr_get_runtime_delegate");
+
+        hostfxr.close =
+            Module::getFunctionByName<hostfxr_close_fn>(module, "hostfxr_close");
+
+        if (!hostfxr.initialize_for_runtime_config || !hostfxr.get_runtime_delegate || !hostfxr.close) {
+            return nullptr;
+        }
+
+        hostfxr.set_error_writer =
+            Module::getFunctionByName<hostfxr_set_error_writer_fn>(module, "hostfxr_set_error_writer");
+
+        hostfxr.get_dotnet_environment_info =
+            Module::getFunctionByName<hostfxr_get_dotnet_environment_info_fn>(module, "hostfxr_get_dotnet_environment_info");
+
+        hostfxr.resolve_frameworks_for_runtime_config =
+            Module::getFunctionByName<hostfxr_resolve_frameworks_for_runtime_config_fn>(module, "hostfxr_resolve_frameworks_for_runtime_config");
+
+        hostfxr.get_runtime_property_value =
+            Module::getFunctionByName<hostfxr_get_runtime_property_value_fn>(module, "hostfxr_get_runtime_property_value");
+
+        hostfxr.initialize_for_dotnet_command_line =
+            Module::getFunctionByName<hostfxr_initialize_for_dotnet_command_line_fn>(module, "hostfxr_initialize_for_dotnet_command_line");
+
+        hostfxr.run_app =
+            Module::getFunctionByName<hostfxr_run_app_fn>(module, "hostfxr_run_app");
+
+        hostfxr.module = module;
+        instance = hostfxr;
+        return &instance;
     }
+};
 
-    /// Obtaining useful exports
-    auto hostfxr_initialize_for_runtime_config_fptr =
-        Module::getFunctionByName<hostfxr_initialize_for_runtime_config_fn>(module, "hostfxr_initialize_for_runtime_config");
+/// Sends hostfxr error messages into diagnostics ring instead of stderr of the process. hostfxr keeps error writer
+/// per thread, so it's installed only around our own calls and the previous writer of this thread is restored after
+class ErrorWriterScope {
+public:
+    explicit ErrorWriterScope(const HostFxr *hostfxr) : hostfxr(hostfxr) {
+        if (hostfxr->set_error_writer) {
+            previous = hostfxr->set_error_writer(write);
+        }
+    }
+
+    ~ErrorWriterScope() {
+        if (hostfxr->set_error_writer) {
+            hostfxr->set_error_writer(previous);
+        }
+    }
 
-    auto hostfxr_get_runtime_delegate_fptr =
-        Module::getFunctionByName<hostfxr_get_runtime_delegate_fn>(module, "hostfxr_get_runtime_delegate");
+private:
+    static void HOSTFXR_CALLTYPE write(const char_t *message) {
+        recordDiagnostic(DiagnosticKind::HostFxrError, InitializeResult::Success, 0, message);
+    }
 
-    auto hostfxr_close_fptr =
-        Module::getFunctionByName<hostfxr_close_fn>(module, "hostfxr_close");
+    const HostFxr *hostfxr;
+    hostfxr_error_writer_fn previous = nullptr;
+};
 
-    /// Load runtime config
+/// Keeps hostfxr context and `load_assembly_and_get_function_pointer` delegate alive between loads,
+/// so only the first payload pays for runtime config initialization
+struct Session {
+    const HostFxr *hostfxr = nullptr;
     hostfxr_handle ctx = nullptr;
-    int rc = hostfxr_initialize_for_runtime_config_fptr(runtime_config_path, nullptr, &ctx);
+    load_assembly_and_get_function_pointer_fn load_assembly = nullptr;
+    /// Delegates for in-memory payloads, requested on first use since they need .NET 8+
+    load_assembly_bytes_fn load_assembly_bytes = nullptr;
+    get_function_pointer_fn get_function_pointer = nullptr;
+
+    /// Function pointers resolved by `bootstrapper_session_invoke`, keyed by "assembly\0type\0method"
+    std::mutex entry_points_mutex;
+    std::unordered_map<std::basic_string<char_t>, component_entry_point_fn> entry_points;
+};
+
+/// Requests delegates that work with default load context
+static bool requestInMemoryDelegates(Session *session) {
+    if (session->load_assembly_bytes && session->get_function_pointer) {
+        return true;
+    }
+
+    void *load_assembly_bytes = nullptr;
+    void *get_function_pointer = nullptr;
+
+    int ret = session->hostfxr->get_runtime_delegate(session->ctx, hostfxr_delegate_type::hdt_load_assembly_bytes,
+                                                     &load_assembly_bytes);
+    if (ret != 0 || load_assembly_bytes == nullptr) {
+        return false;
+    }
+
+    ret = session->hostfxr->get_runtime_delegate(session->ctx, hostfxr_delegate_type::hdt_get_function_pointer,
+                                                 &get_function_pointer);
+    if (ret != 0 || get_function_pointer == nullptr) {
+        return false;
+    }
+
+    session->load_assembly_bytes = reinterpret_cast<load_assembly_bytes_fn>(load_assembly_bytes);
+    session->get_function_pointer = reinterpret_cast<get_function_pointer_fn>(get_function_pointer);
+    return true;
+}
+
+extern "C" EXPORT void bootstrapper_close_session(Session *session) {
+    if (!session) {
+        return;
+    }
+
+    if (session->ctx) {
+        session->hostfxr->close(session->ctx);
+    }
+
+    delete session;
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_open_session(
+    const char_t *runtime_config_path,
+    Session **out_session
+) {
+    *out_session = nullptr;
+    resetReport(Phase::ModuleLookup);
+
+    const HostFxr *hostfxr;
+    {
+        PhaseTimer timer(Phase::ModuleLookup);
+        hostfxr = HostFxr::get();
+    }
+    if (!hostfxr) {
+        return setReportResult(InitializeResult::HostFxrLoadError);
+    }
+
+    auto session = new Session;
+    session->hostfxr = hostfxr;
+    ErrorWriterScope error_writer(hostfxr);
+
+    /// Load runtime config
+    int rc;
+    {
+        PhaseTimer timer(Phase::InitializeRuntimeConfig);
+        rc = hostfxr->initialize_for_runtime_config(runtime_config_path, nullptr, &session->ctx);
+    }
 
     /// Success_HostAlreadyInitialized = 0x00000001
     /// @see https://github.com/dotnet/runtime/blob/main/docs/design/features/host-error-codes.md
-    if (rc != 1 || ctx == nullptr) {
-        hostfxr_close_fptr(ctx);
-        return InitializeResult::InitializeRuntimeConfigError;
+    if (rc != 1 || session->ctx == nullptr) {
+        bootstrapper_close_session(session);
+        recordDiagnostic(DiagnosticKind::SessionError, InitializeResult::InitializeRuntimeConfigError, rc,
+                         runtime_config_path);
+        return setReportResult(InitializeResult::InitializeRuntimeConfigError);
     }
 
     /// From docs: native function pointer to the requested runtime functionality
     void *delegate = nullptr;
-    int ret = hostfxr_get_runtime_delegate_fptr(ctx, hostfxr_delegate_type::hdt_load_assembly_and_get_function_pointer,
-                                                &delegate);
+    int ret;
+    {
+        PhaseTimer timer(Phase::GetRuntimeDelegate);
+        ret = hostfxr->get_runtime_delegate(session->ctx, hostfxr_delegate_type::hdt_load_assembly_and_get_function_pointer,
+                                            &delegate);
+    }
 
     if (ret != 0 || delegate == nullptr) {
-        return InitializeResult::GetRuntimeDelegateError;
+        bootstrapper_close_session(session);
+        recordDiagnostic(DiagnosticKind::SessionError, InitializeResult::GetRuntimeDelegateError, ret,
+                         runtime_config_path);
+        return setReportResult(InitializeResult::GetRuntimeDelegateError);
     }
 
     /// `void *` -> `load_assembly_and_get_function_pointer_fn`, undocumented???
-    auto load_assembly_fptr = reinterpret_cast<load_assembly_and_get_function_pointer_fn>(delegate);
+    session->load_assembly = reinterpret_cast<load_assembly_and_get_function_pointer_fn>(delegate);
+
+    *out_session = session;
+    return setReportResult(InitializeResult::Success);
+}
+
+/// Runtime config is only read during `hostfxr_initialize_for_runtime_config`, so it's written into a file that is
+/// removed once the session is open. hostfxr resolves the path, so a memfd behind `/proc/self/fd/N` is refused
+extern "C" EXPORT InitializeResult bootstrapper_open_session_bytes(
+    const void *runtime_config_bytes,
+    size_t runtime_config_size,
+    Session **out_session
+) {
+    *out_session = nullptr;
+    auto bytes = static_cast<const char *>(runtime_config_bytes);
+
+#ifdef _WIN32
+    wchar_t directory[MAX_PATH], path[MAX_PATH];
+    if (!GetTempPathW(MAX_PATH, directory) || !GetTempFileNameW(directory, L"rtc", 0, path)) {
+        resetReport(Phase::ModuleLookup);
+        return setReportResult(InitializeResult::InitializeRuntimeConfigError);
+    }
+
+    auto file = CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    DWORD written = 0;
+    auto ok = file != INVALID_HANDLE_VALUE &&
+              WriteFile(file, bytes, (DWORD) runtime_config_size, &written, nullptr) &&
+              written == runtime_config_size;
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+#else
+    /// tmpfs is writable in containers with read-only root, same as segments of channels and stats
+    static std::atomic<uint32_t> counter{0};
+    auto name = "/net-core-injector.runtimeconfig-" + std::to_string(getpid()) + "-" +
+                std::to_string(++counter) + ".json";
+    auto shm_path = "/dev/shm" + name;
+    auto path = shm_path.c_str();
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    auto ok = fd >= 0;
+    for (size_t offset = 0; ok && offset < runtime_config_size;) {
+        auto written = write(fd, bytes + offset, runtime_config_size - offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = written > 0;
+        offset += ok ? (size_t) written : 0;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+
+    auto ret = InitializeResult::InitializeRuntimeConfigError;
+    if (ok) {
+        ret = bootstrapper_open_session(path, out_session);
+    } else {
+        resetReport(Phase::ModuleLookup);
+        setReportResult(ret);
+    }
+
+#ifdef _WIN32
+    DeleteFileW(path);
+#else
+    shm_unlink(name.c_str());
+#endif
+    return ret;
+}
+
+template<size_t N>
+static void copyString(char_t (&destination)[N], const char_t *source) {
+    size_t i = 0;
+    for (; source && source[i] && i < N - 1; ++i) {
+        destination[i] = source[i];
+    }
+    destination[i] = 0;
+}
+
+/// 64-bit FNV-1a, pass previous `hash` to continue it
+static uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Entry point is a part of the key, so another entry point of an already loaded assembly can still be called once
+static uint64_t getPayloadKey(uint64_t content_hash, const char_t *type_name, const char_t *method_name) {
+    auto hash = content_hash;
+    for (auto str: {type_name, method_name}) {
+        /// Terminator is hashed too, so ("ab", "c") and ("a", "bc") differ
+        auto len = str ? std::char_traits<char_t>::length(str) + 1 : 0;
+        hash = fnv1a(str, len * sizeof(char_t), hash);
+    }
+    return hash;
+}
+
+/// Payloads whose entry points were called, so a repeated injection, e.g. a rollout that runs `inject` once more,
+/// neither duplicates patches nor pays for runtime config initialization
+class PayloadRegistry {
+public:
+    static PayloadRegistry &instance() {
+        static auto registry = new PayloadRegistry;
+        return *registry;
+    }
+
+    /// Content hash of the file, cached by path, size and modification time, so a repeated injection only stats it.
+    /// Empty if the file can't be read, such payloads are loaded every time
+    std::optional<uint64_t> hashFile(const char_t *path) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        if (error) {
+            return {};
+        }
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error) {
+            return {};
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            auto it = file_hashes.find(path);
+            if (it != file_hashes.end() && it->second.size == size && it->second.modified == modified) {
+                return it->second.hash;
+            }
+        }
+
+        std::ifstream file(std::filesystem::path(path), std::ios::binary);
+        std::vector<char> buffer(64 * 1024);
+        auto hash = fnv1a(nullptr, 0);
+        while (file.read(buffer.data(), (std::streamsize) buffer.size()) || file.gcount() > 0) {
+            hash = fnv1a(buffer.data(), (size_t) file.gcount(), hash);
+        }
+        if (!file.eof()) {
+            return {};
+        }
+
+        std::lock_guard lock(mutex);
+        file_hashes[path] = {size, modified, hash};
+        return hash;
+    }
+
+    /// Counts a repeat if the payload is known
+    bool contains(uint64_t key) {
+        std::lock_guard lock(mutex);
+        return contains(key, lock);
+    }
+
+    /// Adds the payload before its entry point is called, so a concurrent injection of the same payload sees it.
+    /// Returns false and counts a repeat if it's already there
+    bool reserve(uint64_t key, uint64_t content_hash, const char_t *assembly_path, const char_t *type_name,
+                 const char_t *method_name) {
+        std::lock_guard lock(mutex);
+        if (contains(key, lock)) {
+            return false;
+        }
+
+        LoadedPayload payload{};
+        payload.key = key;
+        payload.content_hash = content_hash;
+        payload.loaded_at_us = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        payload.in_memory = assembly_path == nullptr;
+        copyString(payload.assembly_path, assembly_path);
+        copyString(payload.type_name, type_name);
+        copyString(payload.method_name, method_name);
+
+        indices[key] = payloads.size();
+        payloads.push_back(payload);
+        return true;
+    }
+
+    /// Forgets payload that failed to load, so it can be retried
+    void release(uint64_t key) {
+        std::lock_guard lock(mutex);
+        auto it = indices.find(key);
+        if (it == indices.end()) {
+            return;
+        }
+
+        payloads.erase(payloads.begin() + (ptrdiff_t) it->second);
+        indices.clear();
+        for (size_t i = 0; i < payloads.size(); ++i) {
+            indices[payloads[i].key] = i;
+        }
+    }
+
+    size_t list(LoadedPayload *out, size_t capacity) {
+        std::lock_guard lock(mutex);
+        std::copy_n(payloads.begin(), std::min(capacity, payloads.size()), out);
+        return payloads.size();
+    }
+
+private:
+    struct FileHash {
+        uintmax_t size;
+        std::filesystem::file_time_type modified;
+        uint64_t hash;
+    };
+
+    bool contains(uint64_t key, const std::lock_guard<std::mutex> &) {
+        auto it = indices.find(key);
+        if (it == indices.end()) {
+            return false;
+        }
+        ++payloads[it->second].repeat_count;
+        return true;
+    }
+
+    std::mutex mutex;
+    std::vector<LoadedPayload> payloads;
+    std::unordered_map<uint64_t, size_t> indices;
+    std::unordered_map<std::basic_string<char_t>, FileHash> file_hashes;
+};
+
+static InitializeResult reportAlreadyLoaded(const char_t *assembly_path) {
+    recordDiagnostic(DiagnosticKind::Load, InitializeResult::AlreadyLoaded, 0, assembly_path);
+    return setReportResult(InitializeResult::AlreadyLoaded);
+}
+
+extern "C" EXPORT size_t bootstrapper_list_payloads(LoadedPayload *payloads, size_t capacity) {
+    return PayloadRegistry::instance().list(payloads, capacity);
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_session_load(
+    Session *session,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    resetReport(Phase::Prefetch);
 
     typedef void (CORECLR_DELEGATE_CALLTYPE *custom_entry_point_fn)();
     custom_entry_point_fn custom = nullptr;
 
-    ret = load_assembly_fptr(assembly_path, type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr,
-                             (void **) &custom);
+    auto &registry = PayloadRegistry::instance();
+    std::optional<uint64_t> key;
+
+    {
+        PhaseTimer timer(Phase::Prefetch);
+        if (auto content_hash = registry.hashFile(assembly_path)) {
+            key = getPayloadKey(*content_hash, type_name, method_name);
+            if (!registry.reserve(*key, *content_hash, assembly_path, type_name, method_name)) {
+                return reportAlreadyLoaded(assembly_path);
+            }
+        }
+
+        /// Runtime resolves dependencies lazily from the entry point, by then they are in page cache
+        auto prefetch = prefetchDependencies(assembly_path);
+        if (prefetch.files != 0) {
+            setReportPrefetch(prefetch);
+            recordDiagnostic(DiagnosticKind::Prefetch, InitializeResult::Success, (int64_t) prefetch.bytes,
+                             assembly_path);
+        }
+    }
+
+    int ret;
+    {
+        PhaseTimer timer(Phase::LoadAssembly);
+        ret = session->load_assembly(assembly_path, type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr,
+                                     (void **) &custom);
+    }
 
     if (ret != 0 || custom == nullptr) {
-        return InitializeResult::EntryPointError;
+        if (key) {
+            registry.release(*key);
+        }
+        recordDiagnostic(DiagnosticKind::Load, InitializeResult::EntryPointError, ret, assembly_path);
+        return setReportResult(InitializeResult::EntryPointError);
+    }
+
+    {
+        PhaseTimer timer(Phase::EntryPoint);
+        custom();
+    }
+
+    recordDiagnostic(DiagnosticKind::Load, InitializeResult::Success, 0, assembly_path);
+    return setReportResult(InitializeResult::Success);
+}
+
+/// Loads assembly (and optional PDB) from memory buffer into default load context, so payload doesn't have to be
+/// readable by target process from filesystem; entry point is resolved via `hdt_get_function_pointer`.
+/// Pass `type_name == nullptr` to only load the assembly, e.g. dependency of the payload
+extern "C" EXPORT InitializeResult bootstrapper_session_load_bytes(
+    Session *session,
+    const void *assembly_bytes,
+    size_t assembly_size,
+    const void *symbols_bytes,
+    size_t symbols_size,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    resetReport(Phase::Prefetch);
+
+    typedef void (CORECLR_DELEGATE_CALLTYPE *custom_entry_point_fn)();
+    custom_entry_point_fn custom = nullptr;
+
+    {
+        PhaseTimer timer(Phase::LoadAssembly);
+
+        /// Dependencies are registered too, default load context refuses to load the same assembly twice anyway
+        auto &registry = PayloadRegistry::instance();
+        auto content_hash = fnv1a(assembly_bytes, assembly_size);
+        auto key = getPayloadKey(content_hash, type_name, method_name);
+        if (!registry.reserve(key, content_hash, nullptr, type_name, method_name)) {
+            return reportAlreadyLoaded(nullptr);
+        }
+
+        if (!requestInMemoryDelegates(session)) {
+            registry.release(key);
+            return setReportResult(InitializeResult::GetRuntimeDelegateError);
+        }
+
+        int ret = session->load_assembly_bytes(assembly_bytes, assembly_size, symbols_bytes, symbols_size, nullptr,
+                                               nullptr);
+        if (ret != 0) {
+            registry.release(key);
+            recordDiagnostic(DiagnosticKind::Load, InitializeResult::EntryPointError, ret, nullptr);
+            return setReportResult(InitializeResult::EntryPointError);
+        }
+
+        if (type_name == nullptr) {
+            return setReportResult(InitializeResult::Success);
+        }
+
+        ret = session->get_function_pointer(type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr, nullptr,
+                                            (void **) &custom);
+
+        if (ret != 0 || custom == nullptr) {
+            registry.release(key);
+            recordDiagnostic(DiagnosticKind::Load, InitializeResult::EntryPointError, ret, type_name);
+            return setReportResult(InitializeResult::EntryPointError);
+        }
+    }
+
+    {
+        PhaseTimer timer(Phase::EntryPoint);
+        custom();
+    }
+
+    return setReportResult(InitializeResult::Success);
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_session_invoke(
+    Session *session,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    void *arg,
+    int32_t arg_size,
+    int32_t *result
+) {
+    std::basic_string<char_t> key;
+    if (assembly_path) {
+        key += assembly_path;
+    }
+    key += char_t();
+    key += type_name;
+    key += char_t();
+    key += method_name;
+
+    component_entry_point_fn entry_point = nullptr;
+    {
+        std::lock_guard lock(session->entry_points_mutex);
+        if (auto it = session->entry_points.find(key); it != session->entry_points.end()) {
+            entry_point = it->second;
+        }
+    }
+
+    if (!entry_point) {
+        int ret;
+        if (assembly_path) {
+            /// Runtime keeps load context per assembly path, so this resolves method in the already loaded payload
+            ret = session->load_assembly(assembly_path, type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr,
+                                         (void **) &entry_point);
+        } else {
+            if (!requestInMemoryDelegates(session)) {
+                return InitializeResult::GetRuntimeDelegateError;
+            }
+            ret = session->get_function_pointer(type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr, nullptr,
+                                                (void **) &entry_point);
+        }
+
+        if (ret != 0 || entry_point == nullptr) {
+            recordDiagnostic(DiagnosticKind::InvokeError, InitializeResult::EntryPointError, ret, method_name);
+            return InitializeResult::EntryPointError;
+        }
+
+        std::lock_guard lock(session->entry_points_mutex);
+        session->entry_points.emplace(std::move(key), entry_point);
+    }
+
+    int32_t ret = entry_point(arg, arg_size);
+    if (result) {
+        *result = ret;
+    }
+
+    return InitializeResult::Success;
+}
+
+static std::mutex shared_sessions_mutex;
+
+/// Sessions of `bootstrapper_invoke` keyed by runtime config path, they live until process exits
+static std::unordered_map<std::basic_string<char_t>, Session *> shared_sessions;
+
+extern "C" EXPORT InitializeResult bootstrapper_invoke(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    void *arg,
+    int32_t arg_size,
+    int32_t *result
+) {
+    Session *session;
+    {
+        std::lock_guard lock(shared_sessions_mutex);
+        auto &shared = shared_sessions[runtime_config_path];
+        if (!shared) {
+            auto ret = bootstrapper_open_session(runtime_config_path, &shared);
+            if (ret != InitializeResult::Success) {
+                shared_sessions.erase(runtime_config_path);
+                return ret;
+            }
+        }
+        session = shared;
+    }
+
+    return bootstrapper_session_invoke(session, assembly_path, type_name, method_name, arg, arg_size, result);
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_load_assembly(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    /// Repeated injection returns before runtime config is even initialized
+    auto &registry = PayloadRegistry::instance();
+    if (auto content_hash = registry.hashFile(assembly_path)) {
+        if (registry.contains(getPayloadKey(*content_hash, type_name, method_name))) {
+            resetReport(Phase::ModuleLookup);
+            return reportAlreadyLoaded(assembly_path);
+        }
+    }
+
+    Session *session = nullptr;
+    auto ret = bootstrapper_open_session(runtime_config_path, &session);
+    if (ret != InitializeResult::Success) {
+        return ret;
+    }
+
+    ret = bootstrapper_session_load(session, assembly_path, type_name, method_name);
+
+    bootstrapper_close_session(session);
+
+    return ret;
+}
+
+/// Loads all payloads under single runtime config initialization,
+/// `results[i]` receives status of `descriptors[i]` so one failure doesn't hide the others.
+/// Returns the first failure, so the batch doesn't look successful to callers checking only the return value
+extern "C" EXPORT InitializeResult bootstrapper_load_assemblies(
+    const char_t *runtime_config_path,
+    const AssemblyDescriptor *descriptors,
+    size_t count,
+    InitializeResult *results
+) {
+    Session *session = nullptr;
+    auto ret = bootstrapper_open_session(runtime_config_path, &session);
+    if (ret != InitializeResult::Success) {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = ret;
+        }
+        return ret;
+    }
+
+    auto result = InitializeResult::Success;
+    for (size_t i = 0; i < count; ++i) {
+        const auto &descriptor = descriptors[i];
+        results[i] = bootstrapper_session_load(session, descriptor.assembly_path, descriptor.type_name,
+                                               descriptor.method_name);
+        auto failed = results[i] != InitializeResult::Success && results[i] != InitializeResult::AlreadyLoaded;
+        if (failed && result == InitializeResult::Success) {
+            result = results[i];
+        }
+    }
+
+    bootstrapper_close_session(session);
+
+    return result;
+}
+
+static constexpr char_t PATH_SEPARATORS[] = {'/', '\\', 0};
+
+/// Strips `levels` last components of the path
+static std::basic_string<char_t> getParentDirectory(std::basic_string<char_t> path, int levels = 1) {
+    for (int i = 0; i < levels; ++i) {
+        auto separator = path.find_last_of(PATH_SEPARATORS);
+        path.resize(separator == std::basic_string<char_t>::npos ? 0 : separator);
+    }
+    return path;
+}
+
+static std::basic_string<char_t> getFileName(const std::basic_string<char_t> &path) {
+    auto separator = path.find_last_of(PATH_SEPARATORS);
+    return separator == std::basic_string<char_t>::npos ? path : path.substr(separator + 1);
+}
+
+/// Values of `rollForward` ordered by how far they let a framework reference roll
+enum class RollForward {
+    Disable,
+    LatestPatch,
+    Minor,
+    LatestMinor,
+    Major,
+    LatestMajor,
+};
+
+/// Case-insensitive like hostfxr, unknown values make hostfxr reject the config, so they are `nullopt`
+template<typename T>
+static std::optional<RollForward> parseRollForward(const T *value) {
+    static constexpr std::pair<const char *, RollForward> NAMES[] = {
+        {"Disable", RollForward::Disable},
+        {"LatestPatch", RollForward::LatestPatch},
+        {"Minor", RollForward::Minor},
+        {"LatestMinor", RollForward::LatestMinor},
+        {"Major", RollForward::Major},
+        {"LatestMajor", RollForward::LatestMajor},
+    };
+    for (auto [name, roll_forward] : NAMES) {
+        size_t i = 0;
+        for (; value[i] && name[i] && std::tolower((int) value[i]) == std::tolower((int) name[i]); ++i) {
+        }
+        if (!value[i] && !name[i]) {
+            return roll_forward;
+        }
+    }
+    return std::nullopt;
+}
+
+/// Framework reference of runtime config with the `rollForward` that applies to it
+struct FrameworkReference {
+    std::string name;
+    std::string version;
+    RollForward roll_forward;
+};
+
+/// What of runtime config decides whether it fits a running app
+struct RuntimeConfig {
+    /// Empty if hostfxr would reject the config, e.g. for an unknown `rollForward` value
+    std::vector<FrameworkReference> references;
+    /// `configProperties` as hostfxr passes them to the runtime, scalars as they are written
+    std::vector<std::pair<std::string, std::string>> properties;
+};
+
+/// Reads `runtimeOptions.framework` and `runtimeOptions.frameworks[]` of runtime config with the `rollForward` (or
+/// legacy `rollForwardOnNoCandidateFx`) that applies to each: its own one, then the one of `runtimeOptions`, then
+/// `DOTNET_ROLL_FORWARD` of the process, and `runtimeOptions.configProperties`. `nullopt` if the config can't be read
+/// or parsed
+static std::optional<RuntimeConfig> readRuntimeConfig(const char_t *runtime_config_path) {
+    std::ifstream file(std::filesystem::path(runtime_config_path), std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    std::string json{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    struct Reference {
+        std::string name;
+        std::string version;
+        std::optional<RollForward> roll_forward;
+    };
+    std::vector<Reference> references;
+    std::optional<RollForward> default_roll_forward;
+    auto valid = true;
+    RuntimeConfig config;
+
+    JsonReader reader(json);
+    auto readRollForward = [&](std::optional<RollForward> &roll_forward) {
+        std::string value;
+        if (!reader.readString(value)) {
+            return false;
+        }
+        roll_forward = parseRollForward(value.c_str());
+        valid = valid && roll_forward;
+        return true;
+    };
+    /// 0 still rolls to the latest patch unless `applyPatches` is off, `rollForward` takes precedence
+    auto readLegacyRollForward = [&](std::optional<RollForward> &roll_forward) {
+        static constexpr RollForward LEGACY[] = {RollForward::LatestPatch, RollForward::Minor, RollForward::Major};
+        std::string value;
+        if (!reader.readLiteral(value)) {
+            return false;
+        }
+        if (value == "0" || value == "1" || value == "2") {
+            roll_forward = LEGACY[value[0] - '0'];
+        }
+        return true;
+    };
+    auto readFramework = [&] {
+        Reference reference;
+        std::optional<RollForward> legacy;
+        auto parsed = reader.readObject([&](const std::string &key) {
+            if (key == "name") {
+                return reader.readString(reference.name);
+            } else if (key == "version") {
+                return reader.readString(reference.version);
+            } else if (key == "rollForward") {
+                return readRollForward(reference.roll_forward);
+            } else if (key == "rollForwardOnNoCandidateFx") {
+                return readLegacyRollForward(legacy);
+            }
+            return reader.skipValue();
+        });
+
+        valid = valid && !reference.name.empty() && !reference.version.empty();
+        reference.roll_forward = reference.roll_forward ? reference.roll_forward : legacy;
+        references.push_back(std::move(reference));
+        return parsed;
+    };
+
+    auto parsed = reader.readObject([&](const std::string &key) {
+        if (key != "runtimeOptions") {
+            return reader.skipValue();
+        }
+
+        std::optional<RollForward> legacy;
+        auto parsed = reader.readObject([&](const std::string &option) {
+            if (option == "framework") {
+                return readFramework();
+            } else if (option == "frameworks") {
+                return reader.readArray(readFramework);
+            } else if (option == "rollForward") {
+                return readRollForward(default_roll_forward);
+            } else if (option == "rollForwardOnNoCandidateFx") {
+                return readLegacyRollForward(legacy);
+            } else if (option == "configProperties") {
+                return reader.readObject([&](const std::string &name) {
+                    std::string value;
+                    auto parsed = reader.readString(value) || reader.readLiteral(value);
+                    config.properties.emplace_back(name, std::move(value));
+                    return parsed;
+                });
+            }
+            return reader.skipValue();
+        });
+        default_roll_forward = default_roll_forward ? default_roll_forward : legacy;
+        return parsed;
+    });
+    if (!parsed) {
+        return std::nullopt;
+    }
+    if (!valid) {
+        return config;
+    }
+
+    if (!default_roll_forward) {
+#ifdef _WIN32
+        auto variable = _wgetenv(L"DOTNET_ROLL_FORWARD");
+#else
+        auto variable = std::getenv("DOTNET_ROLL_FORWARD");
+#endif
+        default_roll_forward = variable ? parseRollForward(variable) : std::nullopt;
+    }
+
+    for (auto &reference : references) {
+        auto roll_forward = reference.roll_forward.value_or(default_roll_forward.value_or(RollForward::Minor));
+        config.references.push_back({std::move(reference.name), std::move(reference.version), roll_forward});
+    }
+    return config;
+}
+
+/// Whether framework version that is already loaded satisfies the reference, the same rules hostfxr applies to
+/// components of a running app: never older than requested, and every part that differs must be allowed to roll
+static bool fitsLoadedVersion(const FrameworkReference &reference, const char_t *loaded_version) {
+    auto requested = parseVersion(reference.version.c_str());
+    auto loaded = parseVersion(loaded_version);
+    if (loaded < requested || (isPrerelease(loaded_version) && !isPrerelease(reference.version.c_str()))) {
+        return false;
+    }
+    if (loaded[0] != requested[0]) {
+        return reference.roll_forward >= RollForward::Major;
     }
+    if (loaded[1] != requested[1]) {
+        return reference.roll_forward >= RollForward::Minor;
+    }
+    return loaded[2] == requested[2] || reference.roll_forward != RollForward::Disable;
+}
+
+/// Frameworks of the running app as name and version pairs, taken from `TRUSTED_PLATFORM_ASSEMBLIES` of the active host
+/// context where every framework assembly lives in `<dotnet_root>/shared/<name>/<version>/`. `nullopt` if the process
+/// has no active host context, e.g. the runtime was started by a custom host
+static std::optional<std::vector<std::pair<std::basic_string<char_t>, std::basic_string<char_t>>>>
+getLoadedFrameworks(const HostFxr *hostfxr) {
+#ifdef _WIN32
+    auto property = L"TRUSTED_PLATFORM_ASSEMBLIES";
+    static constexpr char_t PATH_LIST_SEPARATOR = ';';
+#else
+    auto property = "TRUSTED_PLATFORM_ASSEMBLIES";
+    static constexpr char_t PATH_LIST_SEPARATOR = ':';
+#endif
+
+    const char_t *assemblies = nullptr;
+    if (!hostfxr->get_runtime_property_value ||
+        hostfxr->get_runtime_property_value(nullptr, property, &assemblies) != 0 || !assemblies) {
+        return std::nullopt;
+    }
+
+    std::vector<std::pair<std::basic_string<char_t>, std::basic_string<char_t>>> frameworks;
+    std::basic_string<char_t> previous_directory;
+    for (auto begin = assemblies; *begin;) {
+        auto end = begin;
+        while (*end && *end != PATH_LIST_SEPARATOR) {
+            ++end;
+        }
+
+        auto directory = getParentDirectory(std::basic_string<char_t>(begin, end));
+        begin = *end ? end + 1 : end;
+        if (directory == previous_directory) {
+            continue;
+        }
+        previous_directory = directory;
+
+        auto framework_directory = getParentDirectory(directory);
+        if (!equalsAscii(getFileName(getParentDirectory(framework_directory)).c_str(), "shared")) {
+            continue;
+        }
+        auto framework = std::make_pair(getFileName(framework_directory), getFileName(directory));
+        if (std::find(frameworks.begin(), frameworks.end(), framework) == frameworks.end()) {
+            frameworks.push_back(std::move(framework));
+        }
+    }
+    return frameworks;
+}
+
+/// Path of coreclr that is running in the process, empty if it's not loaded yet
+static std::basic_string<char_t> getLoadedRuntimePath() {
+#ifdef _WIN32
+    auto module = GetModuleHandleA("coreclr.dll");
+    return module ? Module::getModulePath(module) : std::basic_string<char_t>();
+#else
+    return Module::getPath("libcoreclr.so");
+#endif
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_probe(const char_t *runtime_config_path, ProbeReport *report) {
+    *report = {};
+
+    auto hostfxr = HostFxr::get();
+    if (!hostfxr) {
+        return InitializeResult::HostFxrLoadError;
+    }
+
+    ErrorWriterScope error_writer(hostfxr);
+
+    /// hostfxr lives in `<dotnet_root>/host/fxr/<version>/`
+    auto dotnet_root = getParentDirectory(Module::getModulePath(hostfxr->module), 4);
+    if (hostfxr->get_dotnet_environment_info) {
+        hostfxr->get_dotnet_environment_info(
+            dotnet_root.empty() ? nullptr : dotnet_root.c_str(),
+            nullptr,
+            [](const hostfxr_dotnet_environment_info *info, void *context) {
+                auto report = static_cast<ProbeReport *>(context);
+                copyString(report->hostfxr_version, info->hostfxr_version);
+                report->installed_framework_count = (uint32_t) info->framework_count;
+            },
+            report
+        );
+    }
+
+    /// coreclr lives in `<dotnet_root>/shared/Microsoft.NETCore.App/<version>/`
+    copyString(report->loaded_runtime_version, getFileName(getParentDirectory(getLoadedRuntimePath())).c_str());
+
+    struct Context {
+        ProbeReport *report;
+        size_t unresolved_count;
+    } context{report, 0};
 
-    custom();
+    if (hostfxr->resolve_frameworks_for_runtime_config) {
+        report->resolve_result = hostfxr->resolve_frameworks_for_runtime_config(
+            runtime_config_path,
+            nullptr,
+            [](const hostfxr_resolve_frameworks_result *result, void *data) {
+                auto context = static_cast<Context *>(data);
+                auto add = [&](const hostfxr_framework_result &framework, bool resolved) {
+                    auto report = context->report;
+                    if (report->framework_count == PROBE_MAX_FRAMEWORKS) {
+                        return;
+                    }
 
-    hostfxr_close_fptr(ctx);
+                    auto &entry = report->frameworks[report->framework_count++];
+                    entry.resolved = resolved;
+                    copyString(entry.name, framework.name);
+                    copyString(entry.requested_version, framework.requested_version);
+                    copyString(entry.resolved_version, framework.resolved_version);
+                };
 
+                for (size_t i = 0; i < result->resolved_count; ++i) {
+                    add(result->resolved_frameworks[i], true);
+                }
+                for (size_t i = 0; i < result->unresolved_count; ++i) {
+                    add(result->unresolved_frameworks[i], false);
+                }
+                context->unresolved_count = result->unresolved_count;
+            },
+            &context
+        );
+    }
+
+    /// Until the runtime is loaded the config starts it, so it only has to resolve against installed frameworks
+    if (!report->loaded_runtime_version[0]) {
+        if (!hostfxr->resolve_frameworks_for_runtime_config) {
+            report->verdict = ProbeVerdict::Unknown;
+        } else {
+            auto resolved = report->resolve_result == 0 && context.unresolved_count == 0;
+            report->verdict = resolved ? ProbeVerdict::Compatible : ProbeVerdict::Incompatible;
+        }
+        return InitializeResult::Success;
+    }
+
+    /// Once it's running, hostfxr doesn't resolve anything for another config: each framework it references must be
+    /// one the app has loaded, so a framework that is only installed doesn't help
+    auto loaded_frameworks = getLoadedFrameworks(hostfxr);
+    if (!loaded_frameworks) {
+        report->verdict = ProbeVerdict::Unknown;
+        return InitializeResult::Success;
+    }
+
+    auto findLoaded = [&](const std::basic_string<char_t> &name) -> const char_t * {
+        for (auto &[loaded_name, loaded_version] : *loaded_frameworks) {
+            if (loaded_name == name) {
+                return loaded_version.c_str();
+            }
+        }
+        return nullptr;
+    };
+
+    /// Config that can't be read or parsed here is left undecided rather than guessed
+    auto config = readRuntimeConfig(runtime_config_path);
+    if (!config) {
+        report->verdict = ProbeVerdict::Unknown;
+        return InitializeResult::Success;
+    }
+
+    auto compatible = !config->references.empty();
+    for (auto &reference : config->references) {
+        /// Names and versions are ASCII
+        std::basic_string<char_t> name(reference.name.begin(), reference.name.end());
+        std::basic_string<char_t> version(reference.version.begin(), reference.version.end());
+
+        auto loaded_version = findLoaded(name);
+        compatible = compatible && loaded_version && fitsLoadedVersion(reference, loaded_version);
+
+        /// hostfxr older than .NET 9 didn't list them
+        if (!hostfxr->resolve_frameworks_for_runtime_config && report->framework_count < PROBE_MAX_FRAMEWORKS) {
+            auto &entry = report->frameworks[report->framework_count++];
+            copyString(entry.name, name.c_str());
+            copyString(entry.requested_version, version.c_str());
+        }
+    }
+
+    for (uint32_t i = 0; i < report->framework_count; ++i) {
+        auto &framework = report->frameworks[i];
+        if (auto loaded_version = findLoaded(framework.name)) {
+            copyString(framework.loaded_version, loaded_version);
+        }
+    }
+
+    /// hostfxr reports new or different properties as `Success_DifferentRuntimeProperties`, which the load rejects
+    for (auto &[name, value] : config->properties) {
+        std::basic_string<char_t> property(name.begin(), name.end());
+        const char_t *loaded_value = nullptr;
+        auto same = hostfxr->get_runtime_property_value(nullptr, property.c_str(), &loaded_value) == 0 &&
+                    loaded_value && std::basic_string<char_t>(value.begin(), value.end()) == loaded_value;
+        report->different_property_count += !same;
+    }
+    compatible = compatible && report->different_property_count == 0;
+
+    report->verdict = compatible ? ProbeVerdict::Compatible : ProbeVerdict::Incompatible;
     return InitializeResult::Success;
 }
 
+extern "C" EXPORT InitializeResult bootstrapper_run_app(
+    int argc,
+    const char_t **argv,
+    const AssemblyDescriptor *descriptors,
+    size_t count,
+    InitializeResult *results,
+    int32_t *exit_code
+) {
+    resetReport(Phase::ModuleLookup);
+
+    auto fail = [&](InitializeResult result) {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = result;
+        }
+        return setReportResult(result);
+    };
+
+    const HostFxr *hostfxr;
+    {
+        PhaseTimer timer(Phase::ModuleLookup);
+        hostfxr = HostFxr::get();
+    }
+    if (!hostfxr || !hostfxr->initialize_for_dotnet_command_line || !hostfxr->run_app) {
+        return fail(InitializeResult::HostFxrLoadError);
+    }
+
+    auto session = new Session;
+    session->hostfxr = hostfxr;
+
+    /// hostfxr lives in `<dotnet_root>/host/fxr/<version>/`, frameworks of the app are resolved from there rather
+    /// than from the directory of the launcher
+    auto dotnet_root = getParentDirectory(Module::getModulePath(hostfxr->module), 4);
+    hostfxr_initialize_parameters parameters{sizeof(parameters), nullptr, dotnet_root.c_str()};
+
+    int rc;
+    {
+        ErrorWriterScope error_writer(hostfxr);
+        PhaseTimer timer(Phase::InitializeRuntimeConfig);
+        rc = hostfxr->initialize_for_dotnet_command_line(argc, argv, dotnet_root.empty() ? nullptr : &parameters,
+                                                         &session->ctx);
+    }
+
+    /// Unlike `bootstrapper_open_session`, this context is the first one in the process
+    if (rc != 0 || session->ctx == nullptr) {
+        bootstrapper_close_session(session);
+        recordDiagnostic(DiagnosticKind::SessionError, InitializeResult::InitializeRuntimeConfigError, rc,
+                         argc > 0 ? argv[0] : nullptr);
+        return fail(InitializeResult::InitializeRuntimeConfigError);
+    }
+
+    /// This creates the runtime, but doesn't run anything of the app yet
+    void *delegate = nullptr;
+    int ret;
+    {
+        PhaseTimer timer(Phase::GetRuntimeDelegate);
+        ret = hostfxr->get_runtime_delegate(session->ctx, hostfxr_delegate_type::hdt_load_assembly_and_get_function_pointer,
+                                            &delegate);
+    }
+
+    if (ret != 0 || delegate == nullptr) {
+        bootstrapper_close_session(session);
+        recordDiagnostic(DiagnosticKind::SessionError, InitializeResult::GetRuntimeDelegateError, ret,
+                         argc > 0 ? argv[0] : nullptr);
+        return fail(InitializeResult::GetRuntimeDelegateError);
+    }
+
+    session->load_assembly = reinterpret_cast<load_assembly_and_get_function_pointer_fn>(delegate);
+
+    /// App must not run with only some of its patches applied
+    auto result = InitializeResult::Success;
+    for (size_t i = 0; i < count; ++i) {
+        const auto &descriptor = descriptors[i];
+        results[i] = bootstrapper_session_load(session, descriptor.assembly_path, descriptor.type_name,
+                                               descriptor.method_name);
+        /// Payload passed twice is loaded once, that's no reason not to run the app
+        auto failed = results[i] != InitializeResult::Success && results[i] != InitializeResult::AlreadyLoaded;
+        if (failed && result == InitializeResult::Success) {
+            result = results[i];
+        }
+    }
+
+    if (result == InitializeResult::Success) {
+        *exit_code = hostfxr->run_app(session->ctx);
+    }
+
+    bootstrapper_close_session(session);
+    return result;
+}
+
+/// CPU time consumed by all threads of the process
+static std::chrono::microseconds getProcessCpuTime() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return {};
+    }
+    auto ticks = [](const FILETIME &time) {
+        return ((uint64_t) time.dwHighDateTime << 32) | time.dwLowDateTime;
+    };
+    /// 100 ns units
+    return std::chrono::microseconds((ticks(kernel) + ticks(user)) / 10);
+#else
+    /// Same counters as utime and stime of `/proc/self/stat`, but not rounded to clock ticks
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#endif
+}
+
+/// Waits until CPU usage of the process drops below `percent` of one core or `max` passes, returns the last usage
+static uint32_t waitForIdleProcess(uint32_t percent, std::chrono::milliseconds max) {
+    using namespace std::chrono_literals;
+
+    /// Short windows are dominated by scheduling noise, long ones make the wait coarse
+    constexpr auto window = 100ms;
+
+    auto deadline = std::chrono::steady_clock::now() + max;
+    uint32_t usage;
+    do {
+        auto cpu = getProcessCpuTime();
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(window);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        usage = (uint32_t) ((getProcessCpuTime() - cpu).count() * 100 / std::max<int64_t>(elapsed.count(), 1));
+    } while (usage >= percent && std::chrono::steady_clock::now() < deadline);
+
+    return usage;
+}
+
+/// Applies `WorkerPolicy` to the calling thread. It's created on the worker itself to remember affinity of the
+/// process, which is restored once the policy has no mask
+class ThreadScheduling {
+public:
+    ThreadScheduling() {
+#ifdef _WIN32
+        DWORD_PTR system_affinity;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &inherited_affinity, &system_affinity)) {
+            inherited_affinity = 0;
+        }
+#else
+        CPU_ZERO(&inherited_affinity);
+        pthread_getaffinity_np(pthread_self(), sizeof(inherited_affinity), &inherited_affinity);
+#endif
+    }
+
+    /// Returns the policy that is in effect afterwards
+    WorkerPolicy apply(const WorkerPolicy &policy) {
+        WorkerPolicy applied = policy;
+#ifdef _WIN32
+        auto priority = policy.idle ? THREAD_PRIORITY_IDLE
+                        : policy.nice >= 10 ? THREAD_PRIORITY_LOWEST
+                        : policy.nice > 0 ? THREAD_PRIORITY_BELOW_NORMAL
+                        : THREAD_PRIORITY_NORMAL;
+        if (!SetThreadPriority(GetCurrentThread(), priority)) {
+            applied.nice = 0;
+        }
+        applied.idle = GetThreadPriority(GetCurrentThread()) == THREAD_PRIORITY_IDLE;
+
+        auto affinity = policy.affinity_mask ? (DWORD_PTR) policy.affinity_mask : inherited_affinity;
+        if (!affinity || !SetThreadAffinityMask(GetCurrentThread(), affinity)) {
+            applied.affinity_mask = 0;
+        }
+#else
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), policy.idle ? SCHED_IDLE : SCHED_OTHER, &param);
+        applied.idle = sched_getscheduler(0) == SCHED_IDLE;
+
+        /// Nice value is per thread on Linux, lowering it back may be refused without `CAP_SYS_NICE`
+        setpriority(PRIO_PROCESS, (id_t) gettid(), policy.nice);
+        errno = 0;
+        auto nice = getpriority(PRIO_PROCESS, (id_t) gettid());
+        applied.nice = errno == 0 ? nice : 0;
+
+        cpu_set_t affinity = inherited_affinity;
+        if (policy.affinity_mask) {
+            CPU_ZERO(&affinity);
+            for (int cpu = 0; cpu < 64; ++cpu) {
+                if (policy.affinity_mask & (uint64_t(1) << cpu)) {
+                    CPU_SET(cpu, &affinity);
+                }
+            }
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+
+        applied.affinity_mask = 0;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity) == 0) {
+            for (int cpu = 0; cpu < 64; ++cpu) {
+                if (CPU_ISSET(cpu, &affinity)) {
+                    applied.affinity_mask |= uint64_t(1) << cpu;
+                }
+            }
+        }
+#endif
+        return applied;
+    }
+
+private:
+#ifdef _WIN32
+    DWORD_PTR inherited_affinity;
+#else
+    cpu_set_t inherited_affinity;
+#endif
+};
+
+/// Bootstrapper-owned thread that runs submitted jobs one by one, so the caller's thread is never blocked by
+/// assembly load or a heavy entry point
+class Worker {
+public:
+    static Worker &instance() {
+        static auto worker = new Worker;
+        return *worker;
+    }
+
+    void setPolicy(const WorkerPolicy &new_policy) {
+        std::lock_guard lock(mutex);
+        policy = new_policy;
+    }
+
+    /// `job_policy` applies to this job only, without it the job runs with the policy set by `setPolicy`
+    uint64_t submit(std::function<InitializeResult()> job, std::optional<WorkerPolicy> job_policy = std::nullopt) {
+        std::lock_guard lock(mutex);
+        auto id = ++last_ticket;
+        auto &ticket = tickets[id];
+        ticket.job = std::move(job);
+        ticket.policy = job_policy;
+        ticket.submitted = std::chrono::steady_clock::now();
+        ticket.report.status = TicketStatus::Pending;
+        queue.push_back(id);
+
+        if (!started) {
+            std::thread([this] {
+                run();
+            }).detach();
+            started = true;
+        }
+
+        condition.notify_all();
+        return id;
+    }
+
+    TicketStatus wait(uint64_t id, std::chrono::milliseconds timeout, TicketReport *report) {
+        std::unique_lock lock(mutex);
+
+        /// Lock is released while waiting, so another wait or `forgetUncollected` may erase the ticket meanwhile,
+        /// it's looked up again after every wakeup and never held across one
+        auto find = [&]() -> Ticket * {
+            auto it = tickets.find(id);
+            return it == tickets.end() ? nullptr : &it->second;
+        };
+        if (!find()) {
+            return TicketStatus::Unknown;
+        }
+
+        condition.wait_for(lock, timeout, [&] {
+            auto ticket = find();
+            return !ticket || ticket->report.status == TicketStatus::Completed;
+        });
+
+        auto it = tickets.find(id);
+        if (it == tickets.end()) {
+            return TicketStatus::Unknown;
+        }
+        if (report) {
+            *report = it->second.report;
+        }
+
+        /// Report of a completed ticket is read once, so it's forgotten right away
+        auto status = it->second.report.status;
+        if (status == TicketStatus::Completed) {
+            tickets.erase(it);
+        }
+        return status;
+    }
+
+private:
+    struct Ticket {
+        std::function<InitializeResult()> job;
+        std::optional<WorkerPolicy> policy;
+        std::chrono::steady_clock::time_point submitted;
+        TicketReport report{};
+    };
+
+    void run() {
+        ThreadScheduling scheduling;
+
+        std::unique_lock lock(mutex);
+        while (true) {
+            condition.wait(lock, [&] {
+                return !queue.empty();
+            });
+
+            auto id = queue.front();
+            queue.pop_front();
+
+            auto &ticket = tickets[id];
+            ticket.report.status = TicketStatus::Running;
+            auto job = std::move(ticket.job);
+            auto submitted = ticket.submitted;
+            auto job_policy = ticket.policy.value_or(policy);
+
+            lock.unlock();
+            auto applied = scheduling.apply(job_policy);
+
+            uint32_t cpu_percent = 0;
+            auto deferred = std::chrono::steady_clock::now();
+            if (job_policy.defer_cpu_percent) {
+                cpu_percent = waitForIdleProcess(job_policy.defer_cpu_percent,
+                                                 std::chrono::milliseconds(job_policy.defer_max_ms));
+            }
+            auto started = std::chrono::steady_clock::now();
+            recordSchedule(applied, cpu_percent, started - submitted);
+
+            /// Job runs on this thread, so its report can't be replaced by a load that runs concurrently
+            thread_report = {};
+            auto result = job();
+            auto load_report = thread_report;
+            load_report.result = result;
+            lock.lock();
+
+            /// Ticket is erased only once it's completed and references to elements survive rehashing
+            ticket.report.queue_ns = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                started - submitted).count();
+            ticket.report.deferred_ns = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                started - deferred).count();
+            ticket.report.cpu_percent = cpu_percent;
+            ticket.report.policy = applied;
+            ticket.report.load = load_report;
+            ticket.report.status = TicketStatus::Completed;
+            forgetUncollected(id);
+            condition.notify_all();
+        }
+    }
+
+    /// Tickets whose report nobody reads would stay forever, so only the latest completed ones are kept
+    void forgetUncollected(uint64_t id) {
+        constexpr size_t max_completed = 1024;
+        completed.push_back(id);
+        while (completed.size() > max_completed) {
+            tickets.erase(completed.front());
+            completed.pop_front();
+        }
+    }
+
+    static void recordSchedule(const WorkerPolicy &applied, uint32_t cpu_percent, std::chrono::nanoseconds waited) {
+        char buffer[128];
+        snprintf(buffer, sizeof(buffer), "nice=%d idle=%u affinity=0x%llx cpu=%u%%", applied.nice, applied.idle,
+                 (unsigned long long) applied.affinity_mask, cpu_percent);
+
+        char_t message[128];
+        std::copy(std::begin(buffer), std::end(buffer), message);
+        recordDiagnostic(DiagnosticKind::Schedule, InitializeResult::Success,
+                         std::chrono::duration_cast<std::chrono::microseconds>(waited).count(), message);
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    WorkerPolicy policy{};
+    bool started = false;
+    std::deque<uint64_t> queue;
+    std::unordered_map<uint64_t, Ticket> tickets;
+    /// Completed tickets in order of completion, some of them may already be erased by `wait`
+    std::deque<uint64_t> completed;
+    uint64_t last_ticket = 0;
+};
+
+extern "C" EXPORT void bootstrapper_set_worker_policy(const WorkerPolicy *policy) {
+    Worker::instance().setPolicy(*policy);
+}
+
+extern "C" EXPORT uint64_t bootstrapper_load_assembly_async_with_policy(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    const WorkerPolicy *policy
+) {
+    return Worker::instance().submit([
+        runtime_config_path = std::basic_string<char_t>(runtime_config_path),
+        assembly_path = std::basic_string<char_t>(assembly_path),
+        type_name = std::basic_string<char_t>(type_name),
+        method_name = std::basic_string<char_t>(method_name)
+    ] {
+        return bootstrapper_load_assembly(runtime_config_path.c_str(), assembly_path.c_str(), type_name.c_str(),
+                                          method_name.c_str());
+    }, policy ? std::optional(*policy) : std::nullopt);
+}
+
+extern "C" EXPORT uint64_t bootstrapper_load_assembly_async(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    return bootstrapper_load_assembly_async_with_policy(runtime_config_path, assembly_path, type_name, method_name,
+                                                        nullptr);
+}
+
+extern "C" EXPORT TicketStatus bootstrapper_poll(uint64_t ticket, TicketReport *report) {
+    return Worker::instance().wait(ticket, std::chrono::milliseconds(0), report);
+}
+
+extern "C" EXPORT TicketStatus bootstrapper_wait(uint64_t ticket, uint32_t timeout_ms, TicketReport *report) {
+    return Worker::instance().wait(ticket, std::chrono::milliseconds(timeout_ms), report);
+}
+
 #ifndef _WIN32
 std::string getEnvVar(const char *name) {
     auto val = std::getenv(name);
     return val == nullptr ? std::string() : std::string(val);
 }
 
+/// Checks that both hostfxr and coreclr are mapped, this is cheap enough to be polled
+bool isRuntimeMapped() {
+    return !Module::getPath("libhostfxr.so").empty() && !Module::getPath("libcoreclr.so").empty();
+}
+
+/// `WORKER_*` variables let preloaded payloads stay out of the way of the app's startup, the same way
+/// `bootstrapper_set_worker_policy` does for injected ones
+static WorkerPolicy preloadWorkerPolicy() {
+    auto number = [](const char *name, uint64_t fallback) {
+        auto value = std::getenv(name);
+        return value ? std::strtoull(value, nullptr, 0) : fallback;
+    };
+
+    WorkerPolicy policy{};
+    if (auto nice = std::getenv("WORKER_NICE")) {
+        policy.nice = (int32_t) std::strtol(nice, nullptr, 10);
+    }
+    policy.idle = (uint32_t) number("WORKER_IDLE", 0);
+    policy.affinity_mask = number("WORKER_AFFINITY", 0);
+    policy.defer_cpu_percent = (uint32_t) number("WORKER_DEFER_CPU_PERCENT", 0);
+    policy.defer_max_ms = (uint32_t) number("WORKER_DEFER_MAX_MS", 5000);
+    return policy;
+}
+
+/// Injects entries one by one on the bootstrapper worker
+static void startPreload(std::vector<PreloadEntry> entries, std::chrono::milliseconds timeout) {
+    Worker::instance().setPolicy(preloadWorkerPolicy());
+    Worker::instance().submit([entries = std::move(entries), timeout] {
+        using namespace std::chrono_literals;
+
+        /// Constructor runs before the host even loaded hostfxr, so poll with backoff until runtime is mapped.
+        /// Host context may still be initializing after that, so also retry while hostfxr refuses our config
+        auto start = std::chrono::steady_clock::now();
+        auto result = InitializeResult::Success;
+        for (auto &entry: entries) {
+            auto backoff = 1ms;
+            InitializeResult ret;
+            while (true) {
+                ret = InitializeResult::HostFxrLoadError;
+                if (isRuntimeMapped()) {
+                    if (entry.reload_shim_path.empty()) {
+                        ret = bootstrapper_load_assembly(
+                            entry.runtime_config_path.c_str(),
+                            entry.assembly_path.c_str(),
+                            entry.type_name.c_str(),
+                            entry.method_name.c_str()
+                        );
+                    } else {
+                        /// watcher lives until the process exits
+                        Watcher *watcher;
+                        ret = bootstrapper_watch_assembly(
+                            entry.runtime_config_path.c_str(),
+                            entry.reload_shim_path.c_str(),
+                            entry.assembly_path.c_str(),
+                            entry.type_name.c_str(),
+                            entry.method_name.c_str(),
+                            entry.unload_method_name.empty() ? nullptr : entry.unload_method_name.c_str(),
+                            &watcher
+                        );
+                    }
+                    if (ret != InitializeResult::HostFxrLoadError &&
+                        ret != InitializeResult::InitializeRuntimeConfigError) {
+                        break;
+                    }
+                }
+
+                if (std::chrono::steady_clock::now() - start >= timeout) {
+                    break;
+                }
+
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(backoff * 2, 64ms);
+            }
+
+            auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            recordDiagnostic(DiagnosticKind::Preload, ret, waited.count(), entry.assembly_path.c_str());
+            result = ret;
+        }
+        return result;
+    });
+}
+
 [[gnu::constructor]]
 void initialize_library() {
-    auto runtime_config_path = getEnvVar("RUNTIME_CONFIG_PATH");
-    auto assembly_path = getEnvVar("ASSEMBLY_PATH");
-    auto type_name = getEnvVar("TYPE_NAME");
-    auto method_name = getEnvVar("METHOD_NAME");
-
-    if (!runtime_config_path.empty() && !assembly_path.empty() && !type_name.empty() && !method_name.empty()) {
-        std::thread thread([=] {
-            sleep(1);
-            auto ret = bootstrapper_load_assembly(
-                runtime_config_path.c_str(),
-                assembly_path.c_str(),
-                type_name.c_str(),
-                method_name.c_str()
-            );
-            printf("[+] api.inject() => %d\n", (uint32_t) ret);
-        });
-        thread.detach();
+    /// This runs in every process that inherits `LD_PRELOAD`, so nothing is allocated until it's known to match
+    std::vector<PreloadEntry> entries;
+    if (auto config_path = std::getenv("BOOTSTRAPPER_CONFIG")) {
+        matchPreloadConfig(config_path, entries);
+    } else if (std::getenv("RUNTIME_CONFIG_PATH")) {
+        PreloadEntry entry{
+            getEnvVar("RUNTIME_CONFIG_PATH"),
+            getEnvVar("ASSEMBLY_PATH"),
+            getEnvVar("TYPE_NAME"),
+            getEnvVar("METHOD_NAME"),
+            /// Payload is loaded through `ReloadShim` and reloaded on every rebuild if this is set
+            getEnvVar("RELOAD_SHIM_PATH"),
+            getEnvVar("UNLOAD_METHOD_NAME"),
+        };
+        if (!entry.assembly_path.empty() && !entry.type_name.empty() && !entry.method_name.empty()) {
+            entries.push_back(std::move(entry));
+        }
     }
+
+    if (entries.empty()) {
+        return;
+    }
+
+    /// How long to wait for the runtime before giving up
+    auto timeout_str = getEnvVar("READY_TIMEOUT_MS");
+    auto timeout = std::chrono::milliseconds(timeout_str.empty() ? 10000 : std::strtoul(timeout_str.c_str(), nullptr, 10));
+
+    startPreload(std::move(entries), timeout);
 }
 #endif
@@ -0,0 +1,370 @@
+/// Bootstrapper for `LD_PRELOAD` into a whole fleet of processes: only the preload mode (environment variables or
+/// `BOOTSTRAPPER_CONFIG`) and `bootstrapper_load_assembly`, built without exceptions, RTTI and libstdc++ (see
+/// `BootstrapperMinimal` target). Processes that don't match pay for little more than mapping it: nothing is relocated
+/// against libstdc++ and the constructor only reads the environment and the config
+
+#include "bootstrapper.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <link.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+struct Payload {
+    char runtime_config_path[PATH_MAX];
+    char assembly_path[PATH_MAX];
+    char type_name[512];
+    char method_name[256];
+};
+
+/// Matching `[payload]` sections beyond this are ignored
+static constexpr size_t MAX_PAYLOADS = 4;
+
+/// Copies of environment variables or config entries, the app may change its environment before the runtime is up.
+/// Lives in `.bss`, so there is no static constructor
+static struct {
+    Payload payloads[MAX_PAYLOADS];
+    size_t payload_count;
+    unsigned long timeout_ms;
+} config;
+
+/// Returns false if the value is empty or doesn't fit
+template<size_t N>
+static bool copyValue(std::string_view value, char (&destination)[N]) {
+    if (value.empty() || value.size() >= N) {
+        return false;
+    }
+    memcpy(destination, value.data(), value.size());
+    destination[value.size()] = '\0';
+    return true;
+}
+
+/// Returns false if the variable is missing, empty or doesn't fit
+template<size_t N>
+static bool copyEnvVar(const char *name, char (&destination)[N]) {
+    auto value = getenv(name);
+    return value && copyValue(value, destination);
+}
+
+/// Only members of `std::string_view` that can't throw are used, `substr` would need libstdc++ for its exception
+static std::string_view slice(std::string_view str, size_t begin, size_t end = std::string_view::npos) {
+    end = end > str.size() ? str.size() : end;
+    begin = begin > end ? end : begin;
+    return {str.data() + begin, end - begin};
+}
+
+static std::string_view trim(std::string_view str) {
+    auto begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return slice(str, begin, str.find_last_not_of(" \t\r") + 1);
+}
+
+/// Section of `BOOTSTRAPPER_CONFIG`, values point into the mapped file
+struct Rule {
+    std::string_view exe;
+    std::string_view cmdline;
+    std::string_view runtime_config_path;
+    std::string_view assembly_path;
+    std::string_view type_name;
+    std::string_view method_name;
+};
+
+/// Process properties are read on first use only, into stack buffers
+struct ProcessInfo {
+    char exe_buffer[PATH_MAX];
+    ssize_t exe_length = -1;
+    char cmdline_buffer[4096];
+    ssize_t cmdline_length = -1;
+
+    /// NUL-terminated file name of the executable
+    const char *exe() {
+        if (exe_length < 0) {
+            exe_length = readlink("/proc/self/exe", exe_buffer, sizeof(exe_buffer) - 1);
+            exe_length = exe_length < 0 ? 0 : exe_length;
+            exe_buffer[exe_length] = '\0';
+        }
+        auto slash = strrchr(exe_buffer, '/');
+        return slash ? slash + 1 : exe_buffer;
+    }
+
+    /// Arguments joined with spaces
+    std::string_view cmdline() {
+        if (cmdline_length < 0) {
+            cmdline_length = 0;
+            int fd = open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                auto len = read(fd, cmdline_buffer, sizeof(cmdline_buffer));
+                close(fd);
+                cmdline_length = len < 0 ? 0 : len;
+            }
+            for (ssize_t i = 0; i < cmdline_length; ++i) {
+                if (cmdline_buffer[i] == '\0') {
+                    cmdline_buffer[i] = ' ';
+                }
+            }
+        }
+        return trim(std::string_view(cmdline_buffer, (size_t) cmdline_length));
+    }
+};
+
+static bool matches(const Rule &rule, ProcessInfo &process) {
+    if (!rule.exe.empty()) {
+        char pattern[256];
+        if (!copyValue(rule.exe, pattern) || fnmatch(pattern, process.exe(), 0) != 0) {
+            return false;
+        }
+    }
+
+    if (!rule.cmdline.empty()) {
+        auto cmdline = process.cmdline();
+        if (cmdline.find(rule.cmdline) == std::string_view::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Same format as `BOOTSTRAPPER_CONFIG` of the full bootstrapper (see preload.cpp). `reload_shim_path` and
+/// `unload_method_name` are ignored, reload isn't supported here
+static void matchConfig(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    auto size = (size_t) st.st_size;
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    ProcessInfo process;
+    Rule rule;
+    bool in_section = false;
+
+    auto finishSection = [&] {
+        if (in_section && config.payload_count < MAX_PAYLOADS && matches(rule, process)) {
+            auto &payload = config.payloads[config.payload_count];
+            if (copyValue(rule.runtime_config_path, payload.runtime_config_path) &&
+                copyValue(rule.assembly_path, payload.assembly_path) &&
+                copyValue(rule.type_name, payload.type_name) &&
+                copyValue(rule.method_name, payload.method_name)) {
+                ++config.payload_count;
+            }
+        }
+        rule = {};
+    };
+
+    std::string_view text(static_cast<const char *>(mapping), size);
+    while (!text.empty()) {
+        auto end = text.find('\n');
+        auto line = slice(text, 0, end);
+        line = trim(slice(line, 0, line.find('#')));
+        text = end == std::string_view::npos ? std::string_view() : slice(text, end + 1);
+
+        if (line == "[payload]") {
+            finishSection();
+            in_section = true;
+            continue;
+        }
+
+        auto equals = line.find('=');
+        if (!in_section || equals == std::string_view::npos) {
+            continue;
+        }
+
+        auto key = trim(slice(line, 0, equals));
+        auto value = trim(slice(line, equals + 1));
+        if (key == "exe") {
+            rule.exe = value;
+        } else if (key == "cmdline") {
+            rule.cmdline = value;
+        } else if (key == "runtime_config_path") {
+            rule.runtime_config_path = value;
+        } else if (key == "assembly_path") {
+            rule.assembly_path = value;
+        } else if (key == "type_name") {
+            rule.type_name = value;
+        } else if (key == "method_name") {
+            rule.method_name = value;
+        }
+    }
+    finishSection();
+
+    /// Payloads hold copies of the values
+    munmap(mapping, size);
+}
+
+/// Finds full path of mapped library by its file name, e.g. hostfxr from non-standard `DOTNET_ROOT`
+static bool findMappedLibrary(const char *library, char (&path)[PATH_MAX]) {
+    struct Search {
+        const char *library;
+        char *path;
+        bool found;
+    } search{library, path, false};
+
+    dl_iterate_phdr([](dl_phdr_info *info, size_t, void *data) -> int {
+        auto search = static_cast<Search *>(data);
+        auto slash = strrchr(info->dlpi_name, '/');
+        auto name = slash ? slash + 1 : info->dlpi_name;
+        if (strcmp(name, search->library) != 0 || strlen(info->dlpi_name) >= PATH_MAX) {
+            return 0;
+        }
+        strcpy(search->path, info->dlpi_name);
+        search->found = true;
+        return 1;
+    }, &search);
+
+    return search.found;
+}
+
+/// Checks that both hostfxr and coreclr are mapped, this is cheap enough to be polled
+static bool isRuntimeMapped() {
+    char path[PATH_MAX];
+    return findMappedLibrary("libhostfxr.so", path) && findMappedLibrary("libcoreclr.so", path);
+}
+
+/// Same as in the full bootstrapper, except that hostfxr must already be mapped, `HOSTFXR_PATH` isn't supported
+extern "C" EXPORT InitializeResult bootstrapper_load_assembly(
+    const char_t *runtime_config_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name
+) {
+    char path[PATH_MAX];
+    auto module = findMappedLibrary("libhostfxr.so", path) ? dlopen(path, RTLD_LAZY | RTLD_NOLOAD) : nullptr;
+    if (!module) {
+        return InitializeResult::HostFxrLoadError;
+    }
+
+    auto initialize_for_runtime_config = reinterpret_cast<hostfxr_initialize_for_runtime_config_fn>(
+        dlsym(module, "hostfxr_initialize_for_runtime_config"));
+    auto get_runtime_delegate = reinterpret_cast<hostfxr_get_runtime_delegate_fn>(
+        dlsym(module, "hostfxr_get_runtime_delegate"));
+    auto close = reinterpret_cast<hostfxr_close_fn>(dlsym(module, "hostfxr_close"));
+    /// `RTLD_NOLOAD` still took a reference, the host keeps its own one, so the exports stay valid
+    dlclose(module);
+    if (!initialize_for_runtime_config || !get_runtime_delegate || !close) {
+        return InitializeResult::HostFxrLoadError;
+    }
+
+    /// Success_HostAlreadyInitialized = 0x00000001
+    /// @see https://github.com/dotnet/runtime/blob/main/docs/design/features/host-error-codes.md
+    hostfxr_handle ctx = nullptr;
+    int rc = initialize_for_runtime_config(runtime_config_path, nullptr, &ctx);
+    if (rc != 1 || ctx == nullptr) {
+        if (ctx) {
+            close(ctx);
+        }
+        return InitializeResult::InitializeRuntimeConfigError;
+    }
+
+    void *delegate = nullptr;
+    int ret = get_runtime_delegate(ctx, hostfxr_delegate_type::hdt_load_assembly_and_get_function_pointer, &delegate);
+    if (ret != 0 || delegate == nullptr) {
+        close(ctx);
+        return InitializeResult::GetRuntimeDelegateError;
+    }
+
+    typedef void (CORECLR_DELEGATE_CALLTYPE *custom_entry_point_fn)();
+    custom_entry_point_fn custom = nullptr;
+
+    auto load_assembly = reinterpret_cast<load_assembly_and_get_function_pointer_fn>(delegate);
+    ret = load_assembly(assembly_path, type_name, method_name, UNMANAGEDCALLERSONLY_METHOD, nullptr,
+                        (void **) &custom);
+    if (ret != 0 || custom == nullptr) {
+        close(ctx);
+        return InitializeResult::EntryPointError;
+    }
+
+    custom();
+    close(ctx);
+    return InitializeResult::Success;
+}
+
+static unsigned long getElapsedMs(const timespec &start) {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long) ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+/// Constructor runs before the host even loaded hostfxr, so poll with backoff until runtime is mapped.
+/// Host context may still be initializing after that, so also retry while hostfxr refuses our config.
+/// Payloads are loaded in config order, each one is retried until it's done before the next one starts
+static void *preload(void *) {
+    timespec start{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    size_t next = 0;
+    long backoff_ms = 1;
+    while (next < config.payload_count) {
+        if (isRuntimeMapped()) {
+            auto &payload = config.payloads[next];
+            auto ret = bootstrapper_load_assembly(payload.runtime_config_path, payload.assembly_path,
+                                                  payload.type_name, payload.method_name);
+            if (ret != InitializeResult::HostFxrLoadError && ret != InitializeResult::InitializeRuntimeConfigError) {
+                ++next;
+                continue;
+            }
+        }
+
+        if (getElapsedMs(start) >= config.timeout_ms) {
+            break;
+        }
+
+        timespec backoff{0, backoff_ms * 1000000};
+        nanosleep(&backoff, nullptr);
+        backoff_ms = backoff_ms * 2 > 64 ? 64 : backoff_ms * 2;
+    }
+    return nullptr;
+}
+
+/// This runs in every process that inherits `LD_PRELOAD`, so it allocates nothing and starts no thread until the
+/// environment is known to match
+[[gnu::constructor]]
+static void initialize_library() {
+    if (auto config_path = getenv("BOOTSTRAPPER_CONFIG")) {
+        matchConfig(config_path);
+    } else {
+        auto &payload = config.payloads[0];
+        if (copyEnvVar("RUNTIME_CONFIG_PATH", payload.runtime_config_path) &&
+            copyEnvVar("ASSEMBLY_PATH", payload.assembly_path) &&
+            copyEnvVar("TYPE_NAME", payload.type_name) &&
+            copyEnvVar("METHOD_NAME", payload.method_name)) {
+            config.payload_count = 1;
+        }
+    }
+    if (config.payload_count == 0) {
+        return;
+    }
+
+    /// How long to wait for the runtime before giving up
+    auto timeout = getenv("READY_TIMEOUT_MS");
+    config.timeout_ms = timeout ? strtoul(timeout, nullptr, 10) : 10000;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    pthread_create(&thread, &attr, preload, nullptr);
+    pthread_attr_destroy(&attr);
+}
@@ -0,0 +1,164 @@
+#include "prefetch.h"
+#include "json.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Collects keys of `targets.<framework>.<library>.runtime` and `.native`, i.e. assets relative to the package root
+static std::vector<std::string> readAssets(const std::string &json) {
+    std::vector<std::string> assets;
+
+    JsonReader reader(json);
+    reader.readObject([&](const std::string &key) {
+        if (key != "targets") {
+            return reader.skipValue();
+        }
+        return reader.readObject([&](const std::string &) {
+            return reader.readObject([&](const std::string &) {
+                return reader.readObject([&](const std::string &group) {
+                    if (group != "runtime" && group != "native") {
+                        return reader.skipValue();
+                    }
+                    return reader.readObject([&](const std::string &asset) {
+                        assets.push_back(asset);
+                        return reader.skipValue();
+                    });
+                });
+            });
+        });
+    });
+
+    /// The same library is listed for every target framework and runtime identifier
+    std::sort(assets.begin(), assets.end());
+    assets.erase(std::unique(assets.begin(), assets.end()), assets.end());
+    return assets;
+}
+
+/// Reads the file into page cache and returns its size
+static uint64_t prefetchFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+
+    /// There is no readahead for plain files, reading through is the nearest thing
+    uint64_t size = 0;
+    std::vector<char> buffer(1024 * 1024);
+    DWORD read;
+    while (ReadFile(file, buffer.data(), (DWORD) buffer.size(), &read, nullptr) && read > 0) {
+        size += read;
+    }
+    CloseHandle(file);
+    return size;
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    /// Unlike `POSIX_FADV_WILLNEED` it waits for the read, so per-file time is real, but it's Linux only
+#ifdef __linux__
+    auto read = readahead(fd, 0, (size_t) st.st_size) == 0;
+#else
+    auto read = false;
+#endif
+    if (!read) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+    close(fd);
+    return (uint64_t) st.st_size;
+#endif
+}
+
+PrefetchResult prefetchDependencies(const char_t *assembly_path) {
+    PrefetchResult result{};
+
+    auto enabled = std::getenv("BOOTSTRAPPER_PREFETCH");
+    if (enabled && strcmp(enabled, "0") == 0) {
+        return result;
+    }
+
+    /// Component resolver of the runtime looks for `<assembly>.deps.json` as well
+    std::filesystem::path assembly(assembly_path);
+    auto deps_path = std::filesystem::path(assembly).replace_extension(".deps.json");
+    std::ifstream file(deps_path, std::ios::binary);
+    if (!file) {
+        return result;
+    }
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    /// `dotnet publish` puts assets next to the assembly, `dotnet build` of a project leaves them in the package
+    /// folder, then they aren't prefetched
+    std::vector<std::filesystem::path> paths;
+    auto directory = assembly.parent_path();
+    for (const auto &asset: readAssets(json)) {
+        std::error_code error;
+        auto relative = std::filesystem::path(asset);
+        for (const auto &path: {directory / relative.filename(), directory / relative}) {
+            /// The payload itself is listed too, it has just been read for hashing
+            if (path.filename() != assembly.filename() && std::filesystem::is_regular_file(path, error)) {
+                paths.push_back(path);
+                break;
+            }
+        }
+    }
+    if (paths.empty()) {
+        return result;
+    }
+
+    /// On cold cache every file is a separate seek, so they are read concurrently and the disk queue stays full.
+    /// Threads live only for this call: a load is rare, and a pool would keep up to 7 idle threads (and their stacks)
+    /// in every target. Creating and joining one costs tens of microseconds, far less than a single cold read, and
+    /// the calling thread reads too, so a single file starts none
+    auto thread_count = std::min<size_t>(paths.size(), std::clamp(std::thread::hardware_concurrency(), 2u, 8u));
+    std::atomic<size_t> next{0};
+    std::atomic<uint64_t> bytes{0};
+
+    auto prefetch = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < paths.size();) {
+            bytes += prefetchFile(paths[i]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(prefetch);
+    }
+    prefetch();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    result.files = (uint32_t) paths.size();
+    result.bytes = bytes;
+    result.wall_ns = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "bootstrapper.h"
+
+#include <cstdint>
+
+/// What `prefetchDependencies` has read ahead
+struct PrefetchResult {
+    uint32_t files;
+    uint64_t bytes;
+    /// Wall time of reading them, without parsing `.deps.json`
+    uint64_t wall_ns;
+};
+
+/// Reads runtime assets listed in `.deps.json` next to `assembly_path` into page cache in parallel, so the runtime
+/// doesn't stall on cold disk when it resolves them lazily inside the entry point. Every call starts its own reader
+/// threads, see the comment in the implementation. Does nothing if there is no `.deps.json` or `BOOTSTRAPPER_PREFETCH=0`
+PrefetchResult prefetchDependencies(const char_t *assembly_path);
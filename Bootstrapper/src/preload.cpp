@@ -0,0 +1,197 @@
+#include "preload.h"
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string_view>
+
+/// Config is a list of sections, each of them describes single payload and rules the process must match:
+///
+///     # comment
+///     [payload]
+///     exe = DemoApplication*          # glob over file name of /proc/self/exe, optional
+///     cmdline = --worker              # substring of command line joined with spaces, optional
+///     runtime_config_path = /app/RuntimePatcher.runtimeconfig.json
+///     assembly_path = /app/RuntimePatcher.dll
+///     type_name = RuntimePatcher.Main, RuntimePatcher
+///     method_name = InitializePatches
+///     reload_shim_path = ...          # optional, same as RELOAD_SHIM_PATH
+///     unload_method_name = ...        # optional, same as UNLOAD_METHOD_NAME
+struct PreloadRule {
+    std::string_view exe;
+    std::string_view cmdline;
+    std::string_view runtime_config_path;
+    std::string_view assembly_path;
+    std::string_view type_name;
+    std::string_view method_name;
+    std::string_view reload_shim_path;
+    std::string_view unload_method_name;
+};
+
+static std::string_view trim(std::string_view str) {
+    auto begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    auto end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+}
+
+/// Process properties are read on first use only, stack buffers keep the non-matching path allocation-free
+class ProcessInfo {
+public:
+    std::string_view exe() {
+        if (exe_length < 0) {
+            exe_length = readlink("/proc/self/exe", exe_buffer, sizeof(exe_buffer));
+            if (exe_length < 0) {
+                exe_length = 0;
+            }
+        }
+
+        std::string_view path(exe_buffer, (size_t) exe_length);
+        auto slash = path.rfind('/');
+        return slash == std::string_view::npos ? path : path.substr(slash + 1);
+    }
+
+    std::string_view cmdline() {
+        if (cmdline_length < 0) {
+            cmdline_length = 0;
+            int fd = open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                auto len = read(fd, cmdline_buffer, sizeof(cmdline_buffer));
+                close(fd);
+                cmdline_length = len < 0 ? 0 : len;
+            }
+
+            /// Arguments are separated by NUL, join them with spaces
+            for (ssize_t i = 0; i < cmdline_length; ++i) {
+                if (cmdline_buffer[i] == '\0') {
+                    cmdline_buffer[i] = ' ';
+                }
+            }
+        }
+
+        return trim(std::string_view(cmdline_buffer, (size_t) cmdline_length));
+    }
+
+private:
+    char exe_buffer[4096];
+    ssize_t exe_length = -1;
+    char cmdline_buffer[4096];
+    ssize_t cmdline_length = -1;
+};
+
+static bool matches(const PreloadRule &rule, ProcessInfo &process) {
+    if (rule.runtime_config_path.empty() || rule.assembly_path.empty() || rule.type_name.empty() ||
+        rule.method_name.empty()) {
+        return false;
+    }
+
+    if (!rule.exe.empty()) {
+        char pattern[256];
+        char name[256];
+        auto exe = process.exe();
+        if (rule.exe.size() >= sizeof(pattern) || exe.size() >= sizeof(name)) {
+            return false;
+        }
+
+        memcpy(pattern, rule.exe.data(), rule.exe.size());
+        pattern[rule.exe.size()] = '\0';
+        memcpy(name, exe.data(), exe.size());
+        name[exe.size()] = '\0';
+        if (fnmatch(pattern, name, 0) != 0) {
+            return false;
+        }
+    }
+
+    return rule.cmdline.empty() || process.cmdline().find(rule.cmdline) != std::string_view::npos;
+}
+
+static void appendEntry(const PreloadRule &rule, std::vector<PreloadEntry> &entries) {
+    entries.push_back({
+        std::string(rule.runtime_config_path),
+        std::string(rule.assembly_path),
+        std::string(rule.type_name),
+        std::string(rule.method_name),
+        std::string(rule.reload_shim_path),
+        std::string(rule.unload_method_name),
+    });
+}
+
+void matchPreloadConfig(const char *path, std::vector<PreloadEntry> &entries) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    auto size = (size_t) st.st_size;
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    ProcessInfo process;
+    PreloadRule rule;
+    bool in_section = false;
+
+    auto finishSection = [&] {
+        if (in_section && matches(rule, process)) {
+            appendEntry(rule, entries);
+        }
+        rule = {};
+    };
+
+    std::string_view config(static_cast<const char *>(mapping), size);
+    while (!config.empty()) {
+        auto end = config.find('\n');
+        auto line = config.substr(0, end);
+        line = trim(line.substr(0, line.find('#')));
+        config = end == std::string_view::npos ? std::string_view() : config.substr(end + 1);
+
+        if (line == "[payload]") {
+            finishSection();
+            in_section = true;
+            continue;
+        }
+
+        auto equals = line.find('=');
+        if (!in_section || equals == std::string_view::npos) {
+            continue;
+        }
+
+        auto key = trim(line.substr(0, equals));
+        auto value = trim(line.substr(equals + 1));
+        if (key == "exe") {
+            rule.exe = value;
+        } else if (key == "cmdline") {
+            rule.cmdline = value;
+        } else if (key == "runtime_config_path") {
+            rule.runtime_config_path = value;
+        } else if (key == "assembly_path") {
+            rule.assembly_path = value;
+        } else if (key == "type_name") {
+            rule.type_name = value;
+        } else if (key == "method_name") {
+            rule.method_name = value;
+        } else if (key == "reload_shim_path") {
+            rule.reload_shim_path = value;
+        } else if (key == "unload_method_name") {
+            rule.unload_method_name = value;
+        }
+    }
+    finishSection();
+
+    /// Entries own copies of the strings, so the mapping isn't needed anymore
+    munmap(mapping, size);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// Payload of `LD_PRELOAD` mode, either from environment variables or from matching entry of `BOOTSTRAPPER_CONFIG`
+struct PreloadEntry {
+    std::string runtime_config_path;
+    std::string assembly_path;
+    std::string type_name;
+    std::string method_name;
+    std::string reload_shim_path;
+    std::string unload_method_name;
+};
+
+/// Maps config file and appends entries whose rules match the current process to `entries`. It's called from
+/// constructor of every process that inherits `LD_PRELOAD`, so it doesn't allocate unless some entry matches
+void matchPreloadConfig(const char *path, std::vector<PreloadEntry> &entries);
@@ -0,0 +1,149 @@
+#include "bootstrapper.h"
+#include "diagnostics.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+/// Builds are written as several files (assembly, pdb, deps.json), so wait until the directory is quiet for a while
+static constexpr auto RELOAD_DEBOUNCE = std::chrono::milliseconds(200);
+
+static constexpr auto RELOAD_SHIM_TYPE = "ReloadShim.Loader, ReloadShim";
+static constexpr auto RELOAD_SHIM_METHOD = "Reload";
+
+struct Watcher {
+    int inotify_fd = -1;
+    int stop_fd = -1;
+    std::thread thread;
+
+    std::basic_string<char_t> runtime_config_path;
+    std::basic_string<char_t> shim_path;
+    std::basic_string<char_t> assembly_path;
+    std::string file_name;
+    /// "assembly\0type\0method\0unload" as expected by `ReloadShim.Loader.Reload`
+    std::basic_string<char_t> request;
+
+    InitializeResult reload(int32_t *alive) {
+        return bootstrapper_invoke(runtime_config_path.c_str(), shim_path.c_str(), RELOAD_SHIM_TYPE,
+                                   RELOAD_SHIM_METHOD, request.data(),
+                                   (int32_t) (request.size() * sizeof(char_t)), alive);
+    }
+
+    void watch() {
+        pollfd fds[] = {
+            {inotify_fd, POLLIN, 0},
+            {stop_fd, POLLIN, 0},
+        };
+
+        alignas(inotify_event) char buffer[4096];
+        bool pending = false;
+        while (true) {
+            if (poll(fds, 2, pending ? (int) RELOAD_DEBOUNCE.count() : -1) < 0) {
+                continue;
+            }
+
+            if (fds[1].revents & POLLIN) {
+                break;
+            }
+
+            if (!(fds[0].revents & POLLIN)) {
+                /// debounce timeout elapsed without new events
+                pending = false;
+
+                int32_t alive = -1;
+                auto ret = reload(&alive);
+                recordDiagnostic(DiagnosticKind::Reload, ret, alive, assembly_path.c_str());
+                continue;
+            }
+
+            auto length = read(inotify_fd, buffer, sizeof(buffer));
+            for (char *ptr = buffer; length > 0 && ptr < buffer + length;) {
+                auto event = reinterpret_cast<inotify_event *>(ptr);
+                if (event->len != 0 && file_name == event->name) {
+                    pending = true;
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+};
+
+extern "C" EXPORT void bootstrapper_unwatch_assembly(Watcher *watcher) {
+    if (!watcher) {
+        return;
+    }
+
+    if (watcher->thread.joinable()) {
+        uint64_t value = 1;
+        write(watcher->stop_fd, &value, sizeof(value));
+        watcher->thread.join();
+    }
+
+    if (watcher->inotify_fd >= 0) {
+        close(watcher->inotify_fd);
+    }
+    if (watcher->stop_fd >= 0) {
+        close(watcher->stop_fd);
+    }
+
+    delete watcher;
+}
+
+extern "C" EXPORT InitializeResult bootstrapper_watch_assembly(
+    const char_t *runtime_config_path,
+    const char_t *shim_path,
+    const char_t *assembly_path,
+    const char_t *type_name,
+    const char_t *method_name,
+    const char_t *unload_method_name,
+    Watcher **out_watcher
+) {
+    *out_watcher = nullptr;
+
+    auto watcher = new Watcher;
+    watcher->runtime_config_path = runtime_config_path;
+    watcher->shim_path = shim_path;
+    watcher->assembly_path = assembly_path;
+
+    auto separator = watcher->assembly_path.rfind('/');
+    auto directory = separator == std::string::npos ? std::string(".") : watcher->assembly_path.substr(0, separator);
+    watcher->file_name = separator == std::string::npos ? watcher->assembly_path
+                                                        : watcher->assembly_path.substr(separator + 1);
+
+    for (auto part: {assembly_path, type_name, method_name}) {
+        watcher->request += part;
+        watcher->request += '\0';
+    }
+    watcher->request += unload_method_name ? unload_method_name : "";
+
+    /// Directory is watched instead of the file, since build tools often replace the file by renaming a new one
+    watcher->inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    watcher->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (watcher->inotify_fd < 0 || watcher->stop_fd < 0 ||
+        inotify_add_watch(watcher->inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        bootstrapper_unwatch_assembly(watcher);
+        return InitializeResult::EntryPointError;
+    }
+
+    int32_t alive = -1;
+    auto ret = watcher->reload(&alive);
+    if (ret == InitializeResult::Success && alive < 0) {
+        ret = InitializeResult::EntryPointError;
+    }
+    if (ret != InitializeResult::Success) {
+        bootstrapper_unwatch_assembly(watcher);
+        return ret;
+    }
+
+    watcher->thread = std::thread([watcher] {
+        watcher->watch();
+    });
+
+    *out_watcher = watcher;
+    return InitializeResult::Success;
+}
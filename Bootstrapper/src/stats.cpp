@@ -0,0 +1,143 @@
+#include "bootstrapper.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+/// Layout of shared memory segment, `src/main.ts` reads it directly, so keep them in sync
+struct StatsHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t bucket_count;
+    /// Entries below it have their name written, it's published last
+    std::atomic<uint32_t> count;
+    uint8_t reserved[44];
+};
+
+static_assert(sizeof(StatsHeader) == 64);
+
+/// Bucket `i` counts calls that took [2^i, 2^(i+1)) nanoseconds, the first one also counts 0 ns and the last one
+/// everything longer
+static constexpr uint32_t STATS_BUCKETS = 32;
+
+/// Number of calls is the sum of buckets, so recording is one atomic add less
+struct StatsEntry {
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> buckets[STATS_BUCKETS];
+    char name[112];
+};
+
+static_assert(sizeof(StatsEntry) == 384);
+
+static constexpr uint32_t STATS_MAGIC = 0x5349434e; /// "NCIS"
+static constexpr uint32_t STATS_VERSION = 1;
+static constexpr uint32_t STATS_CAPACITY = 256;
+static constexpr size_t STATS_SIZE = sizeof(StatsHeader) + STATS_CAPACITY * sizeof(StatsEntry);
+
+/// Segment is created by the first registration, so processes without instrumented patches don't get one. The pointer
+/// is published after the header is filled, `bootstrapper_stats_record` reads it without the mutex
+static std::mutex stats_mutex;
+static std::atomic<StatsHeader *> stats = nullptr;
+static std::string stats_name;
+
+static StatsEntry *entries(StatsHeader *header) {
+    return reinterpret_cast<StatsEntry *>(header + 1);
+}
+
+static bool createSegment() {
+    stats_name = "/net-core-injector.stats-" + std::to_string(getpid());
+
+    /// Segment of a dead process with the same pid may still be there
+    shm_unlink(stats_name.c_str());
+    int fd = shm_open(stats_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (ftruncate(fd, (off_t) STATS_SIZE) != 0) {
+        close(fd);
+        shm_unlink(stats_name.c_str());
+        return false;
+    }
+
+    auto mapping = mmap(nullptr, STATS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(stats_name.c_str());
+        return false;
+    }
+
+    auto header = static_cast<StatsHeader *>(mapping);
+    header->capacity = STATS_CAPACITY;
+    header->bucket_count = STATS_BUCKETS;
+    header->version = STATS_VERSION;
+    std::atomic_ref(header->magic).store(STATS_MAGIC, std::memory_order_release);
+    stats.store(header, std::memory_order_release);
+    return true;
+}
+
+/// Segment would outlive the process otherwise, the mapping itself is left to the kernel
+static struct StatsCleanup {
+    ~StatsCleanup() {
+        std::lock_guard lock(stats_mutex);
+        if (stats.load(std::memory_order_relaxed)) {
+            shm_unlink(stats_name.c_str());
+        }
+    }
+} stats_cleanup;
+
+extern "C" EXPORT int32_t bootstrapper_stats_register(const char *name) {
+    /// Truncated names could make two methods share one histogram
+    if (strlen(name) >= sizeof(StatsEntry::name)) {
+        return -1;
+    }
+
+    std::lock_guard lock(stats_mutex);
+    if (!stats.load(std::memory_order_relaxed) && !createSegment()) {
+        return -1;
+    }
+
+    auto header = stats.load(std::memory_order_relaxed);
+    auto count = header->count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (strcmp(entries(header)[i].name, name) == 0) {
+            return (int32_t) i;
+        }
+    }
+
+    if (count == STATS_CAPACITY) {
+        return -1;
+    }
+
+    auto &entry = entries(header)[count];
+    strcpy(entry.name, name);
+    header->count.store(count + 1, std::memory_order_release);
+    return (int32_t) count;
+}
+
+extern "C" EXPORT void bootstrapper_stats_record(int32_t id, uint64_t elapsed_ns) {
+    auto header = stats.load(std::memory_order_acquire);
+    if (id < 0 || (uint32_t) id >= STATS_CAPACITY || !header) {
+        return;
+    }
+
+    auto &entry = entries(header)[id];
+    entry.total_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+
+    auto bucket = std::min<uint32_t>(elapsed_ns == 0 ? 0 : std::bit_width(elapsed_ns) - 1, STATS_BUCKETS - 1);
+    entry.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    /// Plain load first, so calls that aren't a new maximum don't write the cache line once more
+    auto max = entry.max_ns.load(std::memory_order_relaxed);
+    while (elapsed_ns > max && !entry.max_ns.compare_exchange_weak(max, elapsed_ns, std::memory_order_relaxed)) {
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "bootstrapper.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Compares a native string (wide on Windows) with an ASCII literal
+inline bool equalsAscii(const char_t *str, const char *ascii) {
+    while (*str && *str == (char_t) *ascii) {
+        ++str;
+        ++ascii;
+    }
+    return *str == 0 && *ascii == 0;
+}
+
+/// Parses "major.minor.patch[-suffix]", suffix is ignored
+template<typename T>
+std::array<uint32_t, 3> parseVersion(const T *version) {
+    std::array<uint32_t, 3> parts{};
+    for (size_t i = 0; i < parts.size() && *version; ++i) {
+        for (; *version >= '0' && *version <= '9'; ++version) {
+            parts[i] = parts[i] * 10 + (uint32_t) (*version - '0');
+        }
+        if (*version != '.') {
+            break;
+        }
+        ++version;
+    }
+    return parts;
+}
+
+template<typename T>
+bool isPrerelease(const T *version) {
+    for (; *version; ++version) {
+        if (*version == '-') {
+            return true;
+        }
+    }
+    return false;
+}
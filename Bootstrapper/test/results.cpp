@@ -0,0 +1,299 @@
+/// Checks that every `InitializeResult` path of the bootstrapper is reported as expected against `fake_hostfxr`.
+/// Every case runs once, timing is left to `bench/benchmark.cpp`
+
+#include "bootstrapper.h"
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <string>
+
+/// Must match `FakeFailure` of fake_hostfxr
+enum class FakeFailure : uint32_t {
+    None,
+    InitializeRuntimeConfig,
+    GetRuntimeDelegate,
+    LoadAssembly,
+    GetRuntimeProperty,
+};
+
+typedef void (*fake_hostfxr_configure_fn)(uint64_t latency_ns, FakeFailure failure);
+typedef uint64_t (*fake_hostfxr_entry_point_calls_fn)();
+
+static int failures = 0;
+
+/// Writes `content` into a temporary file and returns its path, empty on failure
+static std::string writeTemporaryFile(const char *content) {
+    char path[] = "/tmp/results.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return {};
+    }
+
+    auto size = (ssize_t) strlen(content);
+    auto written = write(fd, content, (size_t) size);
+    close(fd);
+    return written == size ? path : std::string();
+}
+
+/// Runs `op` once and checks that it returned `expected`
+static void check(const char *name, InitializeResult expected, const std::function<InitializeResult()> &op) {
+    auto result = op();
+    bool ok = result == expected;
+    failures += !ok;
+
+    printf("%-36s %-30s %s\n", name, resultName(result), ok ? "ok" : "FAILED");
+}
+
+int main() {
+    const char *runtime_config_path = "fake.runtimeconfig.json";
+    const char *assembly_path = "fake.dll";
+    const char *type_name = "Fake.Main, Fake";
+    const char *method_name = "InitializePatches";
+
+    auto load = [&] {
+        return bootstrapper_load_assembly(runtime_config_path, assembly_path, type_name, method_name);
+    };
+
+    /// hostfxr is not mapped yet
+    check("load (hostfxr missing)", InitializeResult::HostFxrLoadError, load);
+
+    /// First load finds nothing mapped, loads hostfxr from explicit path and caches its exports
+    bootstrapper_set_hostfxr_path(FAKE_HOSTFXR_PATH);
+    check("load (cold, path override)", InitializeResult::Success, load);
+
+    auto fake = dlopen(FAKE_HOSTFXR_PATH, RTLD_NOW | RTLD_NOLOAD);
+    if (!fake) {
+        fprintf(stderr, "%s is not loaded: %s\n", FAKE_HOSTFXR_PATH, dlerror());
+        return 1;
+    }
+    auto configure = reinterpret_cast<fake_hostfxr_configure_fn>(dlsym(fake, "fake_hostfxr_configure"));
+    auto entry_point_calls = reinterpret_cast<fake_hostfxr_entry_point_calls_fn>(
+        dlsym(fake, "fake_hostfxr_entry_point_calls"));
+
+    check("load (warm)", InitializeResult::Success, load);
+
+    Session *session = nullptr;
+    if (bootstrapper_open_session(runtime_config_path, &session) != InitializeResult::Success) {
+        fprintf(stderr, "failed to open session\n");
+        return 1;
+    }
+    check("session_load", InitializeResult::Success, [&] {
+        return bootstrapper_session_load(session, assembly_path, type_name, method_name);
+    });
+    static const char bytes[] = "MZ";
+    auto load_bytes = [&] {
+        return bootstrapper_session_load_bytes(session, bytes, sizeof(bytes), nullptr, 0, type_name, method_name);
+    };
+    check("session_load_bytes", InitializeResult::Success, load_bytes);
+    check("session_load_bytes (repeat)", InitializeResult::AlreadyLoaded, load_bytes);
+    bootstrapper_close_session(session);
+
+    /// `fake.dll` doesn't exist, so every load above went all the way. A readable payload is loaded only once and its
+    /// entry point is never called again. Content differs from `bytes`, the same content would be the same payload
+    static const char file_bytes[] = "MZ file";
+    auto payload_path = writeTemporaryFile(file_bytes);
+    if (payload_path.empty()) {
+        fprintf(stderr, "failed to create payload\n");
+        return 1;
+    }
+
+    auto load_payload = [&] {
+        return bootstrapper_load_assembly(runtime_config_path, payload_path.c_str(), type_name, method_name);
+    };
+    check("load (readable payload)", InitializeResult::Success, load_payload);
+    auto calls = entry_point_calls();
+    check("load (already loaded)", InitializeResult::AlreadyLoaded, [&] {
+        auto ret = load_payload();
+        return entry_point_calls() == calls ? ret : InitializeResult::Success;
+    });
+    unlink(payload_path.c_str());
+
+    char arg[16] = {};
+    check("invoke", InitializeResult::Success, [&] {
+        int32_t result = 0;
+        auto ret = bootstrapper_invoke(runtime_config_path, assembly_path, type_name, "Toggle", arg, sizeof(arg),
+                                       &result);
+        return result == sizeof(arg) ? ret : InitializeResult::EntryPointError;
+    });
+
+    check("load_assembly_async + wait", InitializeResult::Success, [&] {
+        auto ticket = bootstrapper_load_assembly_async(runtime_config_path, assembly_path, type_name, method_name);
+        TicketReport report{};
+        if (bootstrapper_wait(ticket, 10000, &report) != TicketStatus::Completed) {
+            return InitializeResult::EntryPointError;
+        }
+        return report.load.result;
+    });
+
+    auto channel_name = "results." + std::to_string(getpid());
+    auto channel = bootstrapper_open_channel(channel_name.c_str(), 1024, 64, runtime_config_path, assembly_path,
+                                             type_name, "HandleCommand");
+    if (!channel) {
+        fprintf(stderr, "failed to open channel\n");
+        return 1;
+    }
+    check("channel_send (until consumed)", InitializeResult::Success, [&] {
+        auto expected = entry_point_calls() + 16;
+        for (size_t i = 0; i < 16; ++i) {
+            while (!bootstrapper_channel_send(channel, arg, sizeof(arg))) {
+            }
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (entry_point_calls() < expected) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return InitializeResult::EntryPointError;
+            }
+        }
+        return InitializeResult::Success;
+    });
+    bootstrapper_close_channel(channel);
+
+    check("stats_register", InitializeResult::Success, [&] {
+        auto id = bootstrapper_stats_register("results");
+        bootstrapper_stats_record(id, 1500);
+        return id >= 0 && bootstrapper_stats_register("results") == id ? InitializeResult::Success
+                                                                      : InitializeResult::EntryPointError;
+    });
+    check("stats_register (name too long)", InitializeResult::Success, [&] {
+        std::string name(112, 'x');
+        return bootstrapper_stats_register(name.c_str()) == -1 ? InitializeResult::Success
+                                                               : InitializeResult::EntryPointError;
+    });
+
+    AssemblyDescriptor descriptors[16];
+    InitializeResult results[16];
+    for (auto &descriptor: descriptors) {
+        descriptor = {assembly_path, type_name, method_name};
+    }
+    check("load_assemblies (16 payloads)", InitializeResult::Success, [&] {
+        auto ret = bootstrapper_load_assemblies(runtime_config_path, descriptors, 16, results);
+        for (auto result: results) {
+            if (result != InitializeResult::Success) {
+                return result;
+            }
+        }
+        return ret;
+    });
+
+    /// Verdict is mapped to the result that load would have returned, `Unknown` to `HostFxrLoadError`
+    auto probe = [&](const char *path) {
+        ProbeReport report;
+        auto ret = bootstrapper_probe(path, &report);
+        if (ret != InitializeResult::Success) {
+            return ret;
+        }
+        switch (report.verdict) {
+            case ProbeVerdict::Compatible:
+                return InitializeResult::Success;
+            case ProbeVerdict::Incompatible:
+                return InitializeResult::InitializeRuntimeConfigError;
+            default:
+                return InitializeResult::HostFxrLoadError;
+        }
+    };
+    check("probe", InitializeResult::Success, [&] {
+        return probe(runtime_config_path);
+    });
+
+    configure(0, FakeFailure::InitializeRuntimeConfig);
+    check("load (config error)", InitializeResult::InitializeRuntimeConfigError, load);
+    check("probe (framework missing)", InitializeResult::InitializeRuntimeConfigError, [&] {
+        return probe(runtime_config_path);
+    });
+
+    /// More failures than the ring holds, so the oldest events are dropped and the newest are these failures
+    check("drain_diagnostics", InitializeResult::InitializeRuntimeConfigError, [&] {
+        for (int i = 0; i < 1024; ++i) {
+            load();
+        }
+        DiagnosticEvent events[64];
+        uint64_t dropped = 0;
+        auto count = bootstrapper_drain_diagnostics(events, std::size(events), &dropped);
+        if (count == 0 || dropped == 0 || events[count - 1].kind != DiagnosticKind::SessionError) {
+            return InitializeResult::Success;
+        }
+        return events[count - 1].result;
+    });
+
+    configure(0, FakeFailure::GetRuntimeDelegate);
+    check("load (delegate error)", InitializeResult::GetRuntimeDelegateError, load);
+
+    configure(0, FakeFailure::LoadAssembly);
+    check("load (entry point error)", InitializeResult::EntryPointError, load);
+
+    /// From now on the runtime looks loaded, so probe judges configs by frameworks and properties of the running app
+    /// (see `hostfxr_get_runtime_property_value` of fake_hostfxr) instead of resolving them
+    configure(0, FakeFailure::None);
+    if (!dlopen(FAKE_CORECLR_PATH, RTLD_NOW)) {
+        fprintf(stderr, "failed to load %s: %s\n", FAKE_CORECLR_PATH, dlerror());
+        return 1;
+    }
+
+    struct ProbeCase {
+        const char *name;
+        const char *json;
+        InitializeResult expected;
+    };
+    const ProbeCase probe_cases[] = {
+        {"probe running (fits)",
+         R"({"runtimeOptions": {"framework": {"name": "Microsoft.NETCore.App", "version": "10.0.0"}}})",
+         InitializeResult::Success},
+        {"probe running (older major)",
+         R"({"runtimeOptions": {"framework": {"name": "Microsoft.NETCore.App", "version": "9.0.0"}}})",
+         InitializeResult::InitializeRuntimeConfigError},
+        {"probe running (roll to major)",
+         R"({"runtimeOptions": {"rollForward": "Major",
+             "framework": {"name": "Microsoft.NETCore.App", "version": "9.0.0"}}})",
+         InitializeResult::Success},
+        {"probe running (legacy roll)",
+         R"({"runtimeOptions": {"rollForwardOnNoCandidateFx": 2, // comments are allowed
+             "framework": {"version": "9.0.0", "name": "Microsoft.NETCore.App"}}})",
+         InitializeResult::Success},
+        {"probe running (roll disabled)",
+         R"({"runtimeOptions": {"rollForward": "Major", "framework": {"name": "Microsoft.NETCore.App",
+             "version": "10.0.0", "rollForward": "Disable"}}})",
+         InitializeResult::InitializeRuntimeConfigError},
+        {"probe running (both loaded)",
+         R"({"runtimeOptions": {"frameworks": [{"name": "Microsoft.NETCore.App", "version": "10.0.0"},
+             {"name": "Microsoft.AspNetCore.App", "version": "10.0.1"}]}})",
+         InitializeResult::Success},
+        {"probe running (not loaded)",
+         R"({"runtimeOptions": {"frameworks": [{"name": "Microsoft.NETCore.App", "version": "10.0.0"},
+             {"name": "Microsoft.WindowsDesktop.App", "version": "10.0.0"}]}})",
+         InitializeResult::InitializeRuntimeConfigError},
+        {"probe running (other objects)",
+         R"({"runtimeTarget": {"name": "Other.App", "version": "1.0.0"}, "runtimeOptions": {"tfm": "net10.0",
+             "framework": {"name": "Microsoft.NETCore\u002eApp", "version": "10.0.0"},
+             "configProperties": {"System.GC.Server": true}}})",
+         InitializeResult::Success},
+        {"probe running (property differs)",
+         R"({"runtimeOptions": {"framework": {"name": "Microsoft.NETCore.App", "version": "10.0.0"},
+             "configProperties": {"System.GC.Server": false}}})",
+         InitializeResult::InitializeRuntimeConfigError},
+        {"probe running (unparsable)",
+         R"({"runtimeOptions": {"framework": )",
+         InitializeResult::HostFxrLoadError},
+    };
+    for (const auto &probe_case: probe_cases) {
+        auto path = writeTemporaryFile(probe_case.json);
+        check(probe_case.name, probe_case.expected, [&] {
+            return probe(path.c_str());
+        });
+        unlink(path.c_str());
+    }
+
+    auto fitting = writeTemporaryFile(probe_cases[0].json);
+    configure(0, FakeFailure::GetRuntimeProperty);
+    check("probe running (no host context)", InitializeResult::HostFxrLoadError, [&] {
+        return probe(fitting.c_str());
+    });
+    unlink(fitting.c_str());
+
+    return failures == 0 ? 0 : 1;
+}
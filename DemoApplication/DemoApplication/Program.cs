@@ -2,19 +2,33 @@ namespace DemoApplication
 {
     internal class Program
     {
+        /// Set by `benchmark` command of the CLI, so it measures when the line was printed rather than read
+        private static readonly bool timestamps = Environment.GetEnvironmentVariable("DEMO_TIMESTAMPS") != null;
+
         static void Main()
         {
+            var interval = int.TryParse(Environment.GetEnvironmentVariable("DEMO_INTERVAL_MS"), out var ms) ? ms : 1000;
+            var iterations = int.TryParse(Environment.GetEnvironmentVariable("DEMO_ITERATIONS"), out var n) ? n : 30;
+
             int i = 0;
-            while (i < 30)
+            while (i < iterations)
             {
                 F(i++);
-                Thread.Sleep(1000);
+                Thread.Sleep(interval);
             }
         }
 
         static void F(int i)
         {
-            Console.WriteLine($"Number: {i}");
+            if (timestamps)
+            {
+                var now = (DateTime.UtcNow - DateTime.UnixEpoch).TotalMilliseconds;
+                Console.WriteLine($"Number: {i} @ {now.ToString("F3", System.Globalization.CultureInfo.InvariantCulture)}");
+            }
+            else
+            {
+                Console.WriteLine($"Number: {i}");
+            }
         }
     }
 }
@@ -0,0 +1,128 @@
+using System.Reflection;
+using System.Runtime.InteropServices;
+using System.Runtime.Loader;
+
+namespace ReloadShim
+{
+    /// Collectible context of single payload build, it's loaded from bytes, so the files stay writable for the next build
+    internal class PayloadContext : AssemblyLoadContext
+    {
+        private readonly AssemblyDependencyResolver resolver;
+
+        public PayloadContext(string assemblyPath) : base(Path.GetFileName(assemblyPath), isCollectible: true)
+        {
+            resolver = new AssemblyDependencyResolver(assemblyPath);
+        }
+
+        public Assembly LoadFromBytes(string assemblyPath)
+        {
+            using var assembly = new MemoryStream(File.ReadAllBytes(assemblyPath));
+
+            var symbolsPath = Path.ChangeExtension(assemblyPath, ".pdb");
+            if (!File.Exists(symbolsPath))
+            {
+                return LoadFromStream(assembly);
+            }
+
+            using var symbols = new MemoryStream(File.ReadAllBytes(symbolsPath));
+            return LoadFromStream(assembly, symbols);
+        }
+
+        protected override Assembly? Load(AssemblyName assemblyName)
+        {
+            /// framework assemblies are not resolved here and come from the default context
+            var assemblyPath = resolver.ResolveAssemblyToPath(assemblyName);
+            return assemblyPath != null ? LoadFromBytes(assemblyPath) : null;
+        }
+    }
+
+    public class Loader
+    {
+        private static readonly object sync = new();
+        private static readonly List<WeakReference> unloading = new();
+        private static PayloadContext? context;
+        private static Action? unload;
+
+        /// Called via `bootstrapper_invoke` with "assembly\0type\0method\0unload" string in `char_t` encoding.
+        /// Calls `unload` method of the previous build and unloads its context, then loads the new build and calls
+        /// its `[UnmanagedCallersOnly] static void Method()`. Returns number of previous builds that are not collected
+        /// yet (these are kept alive by something that still references the payload) or -1 on failure
+        [UnmanagedCallersOnly]
+        public static int Reload(IntPtr arg, int argSize)
+        {
+            var request = OperatingSystem.IsWindows()
+                ? Marshal.PtrToStringUni(arg, argSize / sizeof(char))
+                : Marshal.PtrToStringUTF8(arg, argSize);
+            var parts = request.Split('\0');
+            if (parts.Length != 4)
+            {
+                return -1;
+            }
+
+            lock (sync)
+            {
+                try
+                {
+                    UnloadCurrent();
+                    LoadNew(parts[0], parts[1], parts[2], parts[3]);
+                }
+                catch (Exception e)
+                {
+                    Console.WriteLine($"Reload of {parts[0]} failed: {e}");
+                    return -1;
+                }
+
+                GC.Collect();
+                GC.WaitForPendingFinalizers();
+                GC.Collect();
+
+                unloading.RemoveAll(reference => !reference.IsAlive);
+                return unloading.Count;
+            }
+        }
+
+        private static void UnloadCurrent()
+        {
+            if (context == null)
+            {
+                return;
+            }
+
+            try
+            {
+                unload?.Invoke();
+            }
+            finally
+            {
+                context.Unload();
+                unloading.Add(new WeakReference(context));
+                context = null;
+                unload = null;
+            }
+        }
+
+        private static unsafe void LoadNew(string assemblyPath, string typeName, string methodName, string unloadMethodName)
+        {
+            var newContext = new PayloadContext(assemblyPath);
+            context = newContext;
+
+            var assembly = newContext.LoadFromBytes(assemblyPath);
+            var type = Type.GetType(typeName, _ => assembly, null, throwOnError: true)!;
+
+            if (unloadMethodName.Length != 0)
+            {
+                var unloadMethod = GetUnmanagedCallersOnly(type, unloadMethodName);
+                unload = () => ((delegate* unmanaged<void>) unloadMethod)();
+            }
+
+            ((delegate* unmanaged<void>) GetUnmanagedCallersOnly(type, methodName))();
+        }
+
+        private static IntPtr GetUnmanagedCallersOnly(Type type, string methodName)
+        {
+            var method = type.GetMethod(methodName, BindingFlags.Public | BindingFlags.NonPublic | BindingFlags.Static)
+                ?? throw new MissingMethodException(type.FullName, methodName);
+            return method.MethodHandle.GetFunctionPointer();
+        }
+    }
+}
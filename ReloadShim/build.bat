@@ -0,0 +1 @@
+dotnet publish -c Release -p:PublishDir="%cd%/dist"
@@ -0,0 +1,12 @@
+@echo off
+
+set PROJECT_NAME=ReloadShim
+set DIRECTORIES=dist .vs %PROJECT_NAME%\bin %PROJECT_NAME%\obj
+
+for %%d in (%DIRECTORIES%) do (
+  if exist %%d (
+    del /s /f /q %%d\*.*
+    for /f %%f in ('dir /ad /b %%d\') do rd /s /q %%d\%%f
+    rd %%d
+  )
+)
@@ -1,5 +1,4 @@
 using HarmonyLib;
-using System.Reflection;
 using System.Runtime.InteropServices;
 
 namespace RuntimePatcher
@@ -14,22 +13,89 @@ namespace RuntimePatcher
             Console.WriteLine("Injected!");
 
             harmony = new Harmony("com.example.patch");
-            harmony.PatchAll(typeof(Main).Assembly);
+            PatchManifest.Apply(harmony);
+        }
+
+        /// Same as `InitializePatches`, but also compiles prefixes and postfixes one by one on this thread before
+        /// returning (Harmony has already compiled the replacements), use it for latency-sensitive targets to avoid
+        /// JIT on the first call after injection
+        [UnmanagedCallersOnly]
+        public static void InitializeAndPreparePatches()
+        {
+            Console.WriteLine("Injected!");
+
+            harmony = new Harmony("com.example.patch");
+            PatchManifest.Apply(harmony, prepare: true);
+        }
+
+        /// Called by `ReloadShim` before the context of this build is unloaded, so the next build patches clean methods
+        [UnmanagedCallersOnly]
+        public static void UnloadPatches()
+        {
+            harmony?.UnpatchAll(harmony.Id);
+            harmony = null;
+        }
+
+        /// Called via `bootstrapper_invoke` with UTF-8 "true" or "false" to toggle patches without reinjection
+        [UnmanagedCallersOnly]
+        public static int SetPatchesEnabled(IntPtr arg, int argSize)
+        {
+            if (!bool.TryParse(Marshal.PtrToStringUTF8(arg, argSize), out var enabled))
+            {
+                return -1;
+            }
+
+            return SetEnabled(enabled);
+        }
+
+        /// Called by consumer thread of `bootstrapper_open_channel` for every message written by `send` command
+        [UnmanagedCallersOnly]
+        public static int HandleCommand(IntPtr arg, int argSize)
+        {
+            var command = Marshal.PtrToStringUTF8(arg, argSize);
+            switch (command)
+            {
+                case "enable":
+                    return SetEnabled(true);
+                case "disable":
+                    return SetEnabled(false);
+                default:
+                    Console.WriteLine($"Unknown command: {command}");
+                    return -1;
+            }
+        }
+
+        private static int SetEnabled(bool enabled)
+        {
+            if (harmony == null)
+            {
+                return -1;
+            }
+
+            harmony.UnpatchAll(harmony.Id);
+            if (enabled)
+            {
+                PatchManifest.Apply(harmony);
+            }
+
+            return enabled ? 1 : 0;
         }
     }
 
-    [HarmonyPatch]
+    /// Listed in `PatchManifest`
     public class ProgramPatches
     {
-        static MethodBase TargetMethod()
+        private static readonly int FStats = PatchStats.Register("DemoApplication.Program.F");
+
+        internal static void F(ref int i, out long __state)
         {
-            return AccessTools.Method(AccessTools.TypeByName("DemoApplication.Program"), "F");
+            __state = PatchStats.Start();
+            i = 1337;
         }
 
-        [HarmonyPrefix]
-        static void F(ref int i)
+        internal static void FPostfix(long __state)
         {
-            i = 1337;
+            PatchStats.Record(FStats, __state);
         }
     }
 }
@@ -0,0 +1,112 @@
+using System.Diagnostics;
+using System.Reflection;
+using System.Runtime.CompilerServices;
+using HarmonyLib;
+
+namespace RuntimePatcher
+{
+    /// Exact target and patch methods, so injection doesn't scan assemblies for `[HarmonyPatch]` attributes
+    public record PatchDescriptor(
+        string AssemblyName,
+        string TypeName,
+        string MethodName,
+        Type[] Parameters,
+        MethodInfo? Prefix,
+        MethodInfo? Postfix
+    );
+
+    public static class PatchManifest
+    {
+        private const BindingFlags PatchFlags = BindingFlags.NonPublic | BindingFlags.Public | BindingFlags.Static;
+        private const BindingFlags TargetFlags = PatchFlags | BindingFlags.Instance;
+
+        /// Add new patch here, target is resolved once by its assembly-qualified name
+        public static readonly PatchDescriptor[] Patches =
+        [
+            new(
+                "DemoApplication",
+                "DemoApplication.Program",
+                "F",
+                [typeof(int)],
+                typeof(ProgramPatches).GetMethod(nameof(ProgramPatches.F), PatchFlags),
+                typeof(ProgramPatches).GetMethod(nameof(ProgramPatches.FPostfix), PatchFlags)
+            ),
+        ];
+
+        /// Resolved targets are kept, so toggling patches later doesn't resolve them again
+        private static readonly MethodBase?[] targets = new MethodBase?[Patches.Length];
+
+        /// Applies every patch of the manifest and prints how long each one took. If `prepare` is set, prefixes and
+        /// postfixes are compiled before it returns, so the first call doesn't JIT on a request thread
+        public static void Apply(Harmony harmony, bool prepare = false)
+        {
+            var methods = new List<MethodInfo>();
+            var applied = 0;
+            var total = Stopwatch.StartNew();
+            for (var i = 0; i < Patches.Length; i++)
+            {
+                var patch = Patches[i];
+                var start = Stopwatch.GetTimestamp();
+
+                var target = targets[i] ??= ResolveTarget(patch);
+                if (target == null)
+                {
+                    Console.WriteLine($"[-] {patch.TypeName}.{patch.MethodName} not found in {patch.AssemblyName}");
+                    continue;
+                }
+
+                harmony.Patch(
+                    target,
+                    prefix: patch.Prefix != null ? new HarmonyMethod(patch.Prefix) : null,
+                    postfix: patch.Postfix != null ? new HarmonyMethod(patch.Postfix) : null
+                );
+                methods.AddRange(new[] { patch.Prefix, patch.Postfix }.OfType<MethodInfo>());
+                applied++;
+
+                var elapsed = Stopwatch.GetElapsedTime(start);
+                Console.WriteLine($"[*] {patch.TypeName}.{patch.MethodName} patched in {elapsed.TotalMilliseconds:F3} ms");
+            }
+
+            Console.WriteLine($"[*] {applied} of {Patches.Length} patches applied in {total.Elapsed.TotalMilliseconds:F3} ms");
+
+            if (prepare)
+            {
+                Prepare(methods.Distinct().ToList(), applied);
+            }
+        }
+
+        /// Only prefixes and postfixes are left to compile: to install the detour Harmony has already compiled the
+        /// replacement, a `DynamicMethod` without a handle to prepare, and redirected compiled target code to it
+        private static void Prepare(List<MethodInfo> methods, int replaced)
+        {
+            var start = Stopwatch.GetTimestamp();
+            var prepared = 0;
+            var skipped = 0;
+            foreach (var method in methods)
+            {
+                try
+                {
+                    RuntimeHelpers.PrepareMethod(method.MethodHandle);
+                    prepared++;
+                }
+                catch (Exception e) when (e is NotSupportedException or InvalidOperationException or ArgumentException)
+                {
+                    /// e.g. open generic method, it can't be compiled without type arguments
+                    Console.WriteLine($"[-] {method.DeclaringType?.Name}.{method.Name} not prepared: {e.Message}");
+                    skipped++;
+                }
+            }
+
+            var elapsed = Stopwatch.GetElapsedTime(start);
+            Console.WriteLine($"[*] {prepared} patch methods prepared and {skipped} skipped in " +
+                              $"{elapsed.TotalMilliseconds:F3} ms, {replaced} replacements were compiled by Harmony");
+        }
+
+        private static MethodBase? ResolveTarget(PatchDescriptor patch)
+        {
+            /// Unlike `AccessTools.TypeByName` this doesn't walk all loaded assemblies
+            var type = Type.GetType($"{patch.TypeName}, {patch.AssemblyName}");
+            return type?.GetMethod(patch.MethodName, TargetFlags, patch.Parameters);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace RuntimePatcher
+{
+    /// Call counters and latency histograms of the bootstrapper, read by `stats <pid>` command without attaching.
+    /// If the bootstrapper doesn't export them (e.g. on Windows), every call is a no-op
+    public static unsafe class PatchStats
+    {
+        private static readonly delegate* unmanaged<byte*, int> register;
+        private static readonly delegate* unmanaged<int, ulong, void> record;
+
+        private static readonly double nanosecondsPerTick = 1e9 / Stopwatch.Frequency;
+
+        static PatchStats()
+        {
+            /// Bootstrapper is already loaded, so this only looks it up by its soname
+            var library = OperatingSystem.IsWindows() ? "Bootstrapper.dll" : "libBootstrapper.so";
+            if (NativeLibrary.TryLoad(library, out var handle) &&
+                NativeLibrary.TryGetExport(handle, "bootstrapper_stats_register", out var registerExport) &&
+                NativeLibrary.TryGetExport(handle, "bootstrapper_stats_record", out var recordExport))
+            {
+                register = (delegate* unmanaged<byte*, int>)registerExport;
+                record = (delegate* unmanaged<int, ulong, void>)recordExport;
+            }
+        }
+
+        /// Returns id for `Record`, keep it in a static field of the patch class. Names longer than 111 UTF-8 bytes get -1,
+        /// so their calls aren't counted
+        public static int Register(string name)
+        {
+            if (register == null)
+            {
+                return -1;
+            }
+
+            var utf8 = Marshal.StringToCoTaskMemUTF8(name);
+            try
+            {
+                return register((byte*)utf8);
+            }
+            finally
+            {
+                Marshal.FreeCoTaskMem(utf8);
+            }
+        }
+
+        /// Pass it from prefix to postfix through Harmony's `__state`
+        public static long Start() => Stopwatch.GetTimestamp();
+
+        public static void Record(int id, long start)
+        {
+            if (record != null && id >= 0)
+            {
+                record(id, (ulong)((Stopwatch.GetTimestamp() - start) * nanosecondsPerTick));
+            }
+        }
+    }
+}
@@ -11,3 +11,7 @@ cd ..
 cd RuntimePatcher
 call build.bat
 cd ..
+
+cd ReloadShim
+call build.bat
+cd ..
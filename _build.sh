@@ -14,3 +14,7 @@ cd ..
 cd RuntimePatcher
 ./build.sh
 cd ..
+
+cd ReloadShim
+./build.sh
+cd ..
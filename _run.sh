@@ -1,31 +1,55 @@
 #!/usr/bin/env bash
 set -e
 
-while getopts "a" OPTION 2> /dev/null; do
+while getopts "anl" OPTION 2> /dev/null; do
   case ${OPTION} in
+    l)
+      USE_LAUNCHER="yes"
+      ;;
     a)
       DO_ATTACH="yes"
       ;;
+    n)
+      DO_ATTACH="yes"
+      USE_NATIVE_INJECTOR="yes"
+      ;;
     \?)
       break
       ;;
   esac
 done
 
-if [ "$DO_ATTACH" == "yes" ]; then
+if [ "$USE_LAUNCHER" == "yes" ]; then
+  BOOTSTRAPPER_VERBOSE=1 \
+  ./Bootstrapper/build/bin/launcher \
+  --payload RuntimePatcher/dist/RuntimePatcher.dll "RuntimePatcher.Main, RuntimePatcher" "InitializePatches" \
+  DemoApplication/dist/DemoApplication.dll
+elif [ "$DO_ATTACH" == "yes" ]; then
   set -m
   sudo sysctl kernel.yama.ptrace_scope=0
 
   ./DemoApplication/dist/DemoApplication &
-  npm start -- inject \
-  DemoApplication \
-  Bootstrapper/build/bin/libBootstrapper.so \
-  RuntimePatcher/dist/RuntimePatcher.runtimeconfig.json \
-  RuntimePatcher/dist/RuntimePatcher.dll \
-  "RuntimePatcher.Main, RuntimePatcher" \
-  "InitializePatches"
+  if [ "$USE_NATIVE_INJECTOR" == "yes" ]; then
+    sleep 1
+    sudo ./Bootstrapper/build/bin/injector \
+    "$!" \
+    Bootstrapper/build/bin/libBootstrapper.so \
+    RuntimePatcher/dist/RuntimePatcher.runtimeconfig.json \
+    RuntimePatcher/dist/RuntimePatcher.dll \
+    "RuntimePatcher.Main, RuntimePatcher" \
+    "InitializePatches"
+  else
+    npm start -- inject \
+    DemoApplication \
+    Bootstrapper/build/bin/libBootstrapper.so \
+    RuntimePatcher/dist/RuntimePatcher.runtimeconfig.json \
+    RuntimePatcher/dist/RuntimePatcher.dll \
+    "RuntimePatcher.Main, RuntimePatcher" \
+    "InitializePatches"
+  fi
   fg %1
 else
+  BOOTSTRAPPER_VERBOSE=1 \
   LD_PRELOAD=./Bootstrapper/build/bin/libBootstrapper.so \
   RUNTIME_CONFIG_PATH="$(pwd)/RuntimePatcher/dist/RuntimePatcher.runtimeconfig.json" \
   ASSEMBLY_PATH="$(pwd)/RuntimePatcher/dist/RuntimePatcher.dll" \
@@ -1,11 +1,97 @@
+const allocUtfString = Process.platform === "windows" ? Memory.allocUtf16String : Memory.allocUtf8String;
+
+interface AssemblyDescriptor {
+    assembly_path: string;
+    type_name: string;
+    method_name: string;
+}
+
+interface InMemoryAssembly {
+    assembly: string;
+    symbols: string | null;
+}
+
+/// Must match `Phase` enum of the bootstrapper
+const PHASES = ["ModuleLookup", "InitializeRuntimeConfig", "GetRuntimeDelegate", "Prefetch", "LoadAssembly", "EntryPoint"];
+
+/// struct LoadReport { uint32_t result; struct { uint64_t duration_ns; int64_t rss_delta_bytes; } phases[];
+///                     uint32_t prefetch_files; uint64_t prefetch_bytes; uint64_t prefetch_ns; }
+const LOAD_REPORT_SIZE = 8 + PHASES.length * 16 + 24;
+
+/// Must match `TicketStatus` enum of the bootstrapper
+const TICKET_STATUSES = ["Unknown", "Pending", "Running", "Completed"];
+
+/// Must match `ProbeVerdict` enum of the bootstrapper
+const PROBE_VERDICTS = ["Unknown", "Compatible", "Incompatible"];
+
+const PROBE_MAX_FRAMEWORKS = 8;
+
+/// Must match `InitializeResult::AlreadyLoaded` of the bootstrapper
+const ALREADY_LOADED = 5;
+
+/// Must match `DiagnosticKind` enum of the bootstrapper
+const DIAGNOSTIC_KINDS = ["HostFxrError", "SessionError", "Load", "InvokeError", "Preload", "Reload", "Schedule", "Prefetch"];
+
+/// Size of `char_t` of the bootstrapper
+const CHAR_SIZE = Process.platform === "windows" ? 2 : 1;
+
+function readCharString(pointer: NativePointer): string {
+    return (Process.platform === "windows" ? pointer.readUtf16String() : pointer.readUtf8String()) ?? "";
+}
+
+function readLoadReport(report: NativePointer) {
+    const prefetch = report.add(8 + PHASES.length * 16);
+    return {
+        result: report.readU32(),
+        phases: PHASES.map((name, i) => {
+            const phase = report.add(8 + i * 16);
+            return {
+                name,
+                duration_ns: phase.readU64().toNumber(),
+                rss_delta_bytes: phase.add(8).readS64().toNumber(),
+            };
+        }),
+        prefetch_files: prefetch.readU32(),
+        prefetch_bytes: prefetch.add(8).readU64().toNumber(),
+        prefetch_ns: prefetch.add(16).readU64().toNumber(),
+    };
+}
+
+/// Runtime config, assembly and PDB bytes are pushed by CLI via `script.post()` before `injectBytes` is called
+const buffers = new Map<string, ArrayBuffer>();
+
+function receiveBuffers() {
+    recv("buffer", (message, data) => {
+        if (data !== null) {
+            buffers.set(message.name, data);
+        }
+        receiveBuffers();
+    });
+}
+
+receiveBuffers();
+
+function allocBuffer(name: string | null): [NativePointer, number] {
+    const data = name === null ? undefined : buffers.get(name);
+    if (data === undefined) {
+        return [NULL, 0];
+    }
+
+    const buffer = Memory.alloc(data.byteLength);
+    buffer.writeByteArray(data);
+    return [buffer, data.byteLength];
+}
+
+function getBootstrapperExport(bootstrapper: string, name: string): NativePointer {
+    const bootstrapperModule = Module.load(bootstrapper);
+    return bootstrapperModule.getExportByName(name);
+}
+
 rpc.exports = {
     inject: (bootstrapper: string, runtime_config_path: string, assembly_path: string, type_name: string, method_name: string): number => {
-        const bootstrapperModule = Module.load(bootstrapper);
-
-        const functionPointer = bootstrapperModule.getExportByName("bootstrapper_load_assembly");
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_load_assembly");
         const bootstrapper_load_assembly = new NativeFunction(functionPointer, "uint32", ["pointer", "pointer", "pointer", "pointer"], { exceptions: "propagate" });
 
-        const allocUtfString = Process.platform === "windows" ? Memory.allocUtf16String : Memory.allocUtf8String;
         return bootstrapper_load_assembly(
             allocUtfString(runtime_config_path),
             allocUtfString(assembly_path),
@@ -13,4 +99,283 @@ rpc.exports = {
             allocUtfString(method_name),
         );
     },
+    injectBytes: (bootstrapper: string, runtime_config: string, assemblies: InMemoryAssembly[], type_name: string, method_name: string): number => {
+        const bootstrapper_open_session_bytes = new NativeFunction(getBootstrapperExport(bootstrapper, "bootstrapper_open_session_bytes"), "uint32", ["pointer", "size_t", "pointer"], { exceptions: "propagate" });
+        const bootstrapper_session_load_bytes = new NativeFunction(getBootstrapperExport(bootstrapper, "bootstrapper_session_load_bytes"), "uint32", ["pointer", "pointer", "size_t", "pointer", "size_t", "pointer", "pointer"], { exceptions: "propagate" });
+        const bootstrapper_close_session = new NativeFunction(getBootstrapperExport(bootstrapper, "bootstrapper_close_session"), "void", ["pointer"], { exceptions: "propagate" });
+
+        const sessionPointer = Memory.alloc(Process.pointerSize);
+        const [configBytes, configSize] = allocBuffer(runtime_config);
+        let ret = bootstrapper_open_session_bytes(configBytes, configSize, sessionPointer);
+        if (ret !== 0) {
+            buffers.clear();
+            return ret;
+        }
+        const session = sessionPointer.readPointer();
+
+        /// dependencies go first and the payload with entry point is the last one
+        for (const [i, assembly] of assemblies.entries()) {
+            const [assemblyBytes, assemblySize] = allocBuffer(assembly.assembly);
+            const [symbolsBytes, symbolsSize] = allocBuffer(assembly.symbols);
+            const isPayload = i === assemblies.length - 1;
+
+            ret = bootstrapper_session_load_bytes(
+                session,
+                assemblyBytes,
+                assemblySize,
+                symbolsBytes,
+                symbolsSize,
+                isPayload ? allocUtfString(type_name) : NULL,
+                isPayload ? allocUtfString(method_name) : NULL,
+            );
+            /// dependency of the previous injection is still there
+            if (ret !== 0 && ret !== ALREADY_LOADED) {
+                break;
+            }
+        }
+
+        bootstrapper_close_session(session);
+        buffers.clear();
+
+        return ret;
+    },
+    invoke: (bootstrapper: string, runtime_config_path: string, assembly_path: string | null, type_name: string, method_name: string, arg: number[]) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_invoke");
+        const bootstrapper_invoke = new NativeFunction(functionPointer, "uint32", ["pointer", "pointer", "pointer", "pointer", "pointer", "int32", "pointer"], { exceptions: "propagate" });
+
+        const argBuffer = Memory.alloc(Math.max(arg.length, 1));
+        argBuffer.writeByteArray(arg);
+
+        const result = Memory.alloc(4);
+        const ret = bootstrapper_invoke(
+            allocUtfString(runtime_config_path),
+            assembly_path !== null ? allocUtfString(assembly_path) : NULL,
+            allocUtfString(type_name),
+            allocUtfString(method_name),
+            argBuffer,
+            arg.length,
+            result,
+        );
+
+        return {ret, result: result.readS32()};
+    },
+    openChannel: (bootstrapper: string, name: string, slot_count: number, slot_size: number, runtime_config_path: string, assembly_path: string | null, type_name: string, method_name: string): boolean => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_open_channel");
+        const bootstrapper_open_channel = new NativeFunction(functionPointer, "pointer", ["pointer", "uint32", "uint32", "pointer", "pointer", "pointer", "pointer"], { exceptions: "propagate" });
+
+        /// channel lives until the process exits
+        const channel = bootstrapper_open_channel(
+            Memory.allocUtf8String(name),
+            slot_count,
+            slot_size,
+            allocUtfString(runtime_config_path),
+            assembly_path !== null ? allocUtfString(assembly_path) : NULL,
+            allocUtfString(type_name),
+            allocUtfString(method_name),
+        );
+
+        return !channel.isNull();
+    },
+    watch: (bootstrapper: string, runtime_config_path: string, shim_path: string, assembly_path: string, type_name: string, method_name: string, unload_method_name: string | null): number => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_watch_assembly");
+        const bootstrapper_watch_assembly = new NativeFunction(functionPointer, "uint32", ["pointer", "pointer", "pointer", "pointer", "pointer", "pointer", "pointer"], { exceptions: "propagate" });
+
+        /// watcher lives until the process exits
+        const watcher = Memory.alloc(Process.pointerSize);
+        return bootstrapper_watch_assembly(
+            allocUtfString(runtime_config_path),
+            allocUtfString(shim_path),
+            allocUtfString(assembly_path),
+            allocUtfString(type_name),
+            allocUtfString(method_name),
+            unload_method_name !== null ? allocUtfString(unload_method_name) : NULL,
+            watcher,
+        );
+    },
+    setHostFxrPath: (bootstrapper: string, hostfxr_path: string) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_set_hostfxr_path");
+        const bootstrapper_set_hostfxr_path = new NativeFunction(functionPointer, "void", ["pointer"], { exceptions: "propagate" });
+
+        bootstrapper_set_hostfxr_path(allocUtfString(hostfxr_path));
+    },
+    getLastReport: (bootstrapper: string) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_get_last_report");
+        const bootstrapper_get_last_report = new NativeFunction(functionPointer, "void", ["pointer"], { exceptions: "propagate" });
+
+        const report = Memory.alloc(LOAD_REPORT_SIZE);
+        bootstrapper_get_last_report(report);
+
+        return readLoadReport(report);
+    },
+    probe: (bootstrapper: string, runtime_config_path: string) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_probe");
+        const bootstrapper_probe = new NativeFunction(functionPointer, "uint32", ["pointer", "pointer"], { exceptions: "propagate" });
+
+        /// struct ProbeReport { uint32_t verdict; int32_t resolve_result; char_t hostfxr_version[32];
+        /// char_t loaded_runtime_version[32]; uint32_t installed_framework_count; uint32_t framework_count;
+        /// struct { uint32_t resolved; char_t name[64]; char_t requested_version[32]; char_t resolved_version[32];
+        /// char_t loaded_version[32]; } frameworks[]; uint32_t different_property_count; }
+        const frameworksOffset = 16 + 64 * CHAR_SIZE;
+        const frameworkSize = 4 + 160 * CHAR_SIZE;
+        const propertiesOffset = frameworksOffset + PROBE_MAX_FRAMEWORKS * frameworkSize;
+        const report = Memory.alloc(propertiesOffset + 4);
+        const ret = bootstrapper_probe(allocUtfString(runtime_config_path), report);
+
+        const frameworkCount = report.add(12 + 64 * CHAR_SIZE).readU32();
+        return {
+            ret,
+            verdict: PROBE_VERDICTS[report.readU32()] ?? "Unknown",
+            resolve_result: report.add(4).readS32(),
+            hostfxr_version: readCharString(report.add(8)),
+            loaded_runtime_version: readCharString(report.add(8 + 32 * CHAR_SIZE)),
+            installed_framework_count: report.add(8 + 64 * CHAR_SIZE).readU32(),
+            different_property_count: report.add(propertiesOffset).readU32(),
+            frameworks: Array.from({length: frameworkCount}, (_, i) => {
+                const framework = report.add(frameworksOffset + i * frameworkSize);
+                return {
+                    name: readCharString(framework.add(4)),
+                    requested_version: readCharString(framework.add(4 + 64 * CHAR_SIZE)),
+                    resolved_version: readCharString(framework.add(4 + 96 * CHAR_SIZE)),
+                    loaded_version: readCharString(framework.add(4 + 128 * CHAR_SIZE)),
+                    resolved: framework.readU32() !== 0,
+                };
+            }),
+        };
+    },
+    drainDiagnostics: (bootstrapper: string) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_drain_diagnostics");
+        const bootstrapper_drain_diagnostics = new NativeFunction(functionPointer, "size_t", ["pointer", "size_t", "pointer"], { exceptions: "propagate" });
+
+        /// struct DiagnosticEvent { uint64_t position; uint64_t timestamp_us; uint32_t kind; uint32_t result; int64_t value; char_t message[224]; }
+        const eventSize = 32 + 224 * CHAR_SIZE;
+        const capacity = 64;
+        const buffer = Memory.alloc(capacity * eventSize);
+        const droppedPointer = Memory.alloc(8);
+
+        const events = [];
+        let dropped = 0;
+        while (true) {
+            const count = Number(bootstrapper_drain_diagnostics(buffer, capacity, droppedPointer));
+            dropped += droppedPointer.readU64().toNumber();
+
+            for (let i = 0; i < count; i++) {
+                const event = buffer.add(i * eventSize);
+                events.push({
+                    position: event.readU64().toNumber(),
+                    timestamp_us: event.add(8).readU64().toNumber(),
+                    kind: DIAGNOSTIC_KINDS[event.add(16).readU32()] ?? "Unknown",
+                    result: event.add(20).readU32(),
+                    value: event.add(24).readS64().toNumber(),
+                    message: readCharString(event.add(32)),
+                });
+            }
+
+            if (count < capacity) {
+                break;
+            }
+        }
+
+        return {events, dropped};
+    },
+    listPayloads: (bootstrapper: string) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_list_payloads");
+        const bootstrapper_list_payloads = new NativeFunction(functionPointer, "size_t", ["pointer", "size_t"], { exceptions: "propagate" });
+
+        /// struct LoadedPayload { uint64_t key; uint64_t content_hash; uint64_t loaded_at_us; uint32_t repeat_count;
+        /// uint32_t in_memory; char_t assembly_path[256]; char_t type_name[128]; char_t method_name[128]; }
+        const payloadSize = 32 + 512 * CHAR_SIZE;
+        let capacity = 64;
+        let buffer = Memory.alloc(capacity * payloadSize);
+        let count = Number(bootstrapper_list_payloads(buffer, capacity));
+        if (count > capacity) {
+            capacity = count;
+            buffer = Memory.alloc(capacity * payloadSize);
+            count = Math.min(Number(bootstrapper_list_payloads(buffer, capacity)), capacity);
+        }
+
+        return Array.from({length: count}, (_, i) => {
+            const payload = buffer.add(i * payloadSize);
+            return {
+                key: payload.readU64().toString(16).padStart(16, "0"),
+                content_hash: payload.add(8).readU64().toString(16).padStart(16, "0"),
+                loaded_at_us: payload.add(16).readU64().toNumber(),
+                repeat_count: payload.add(24).readU32(),
+                in_memory: payload.add(28).readU32() !== 0,
+                assembly_path: readCharString(payload.add(32)),
+                type_name: readCharString(payload.add(32 + 256 * CHAR_SIZE)),
+                method_name: readCharString(payload.add(32 + 384 * CHAR_SIZE)),
+            };
+        });
+    },
+    /// `policy` schedules this job only, without it the job runs with the default policy of the worker
+    injectAsync: (bootstrapper: string, runtime_config_path: string, assembly_path: string, type_name: string, method_name: string, policy?: {nice: number, idle: boolean, affinity_mask: string, defer_cpu_percent: number, defer_max_ms: number}): number => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_load_assembly_async_with_policy");
+        const bootstrapper_load_assembly_async_with_policy = new NativeFunction(functionPointer, "uint64", ["pointer", "pointer", "pointer", "pointer", "pointer"], { exceptions: "propagate" });
+
+        /// struct WorkerPolicy { int32_t nice; uint32_t idle; uint64_t affinity_mask; uint32_t defer_cpu_percent; uint32_t defer_max_ms; }
+        let policyPointer = NULL;
+        if (policy !== undefined) {
+            policyPointer = Memory.alloc(24);
+            policyPointer.writeS32(policy.nice);
+            policyPointer.add(4).writeU32(policy.idle ? 1 : 0);
+            policyPointer.add(8).writeU64(uint64(policy.affinity_mask));
+            policyPointer.add(16).writeU32(policy.defer_cpu_percent);
+            policyPointer.add(20).writeU32(policy.defer_max_ms);
+        }
+
+        const ticket = bootstrapper_load_assembly_async_with_policy(
+            allocUtfString(runtime_config_path),
+            allocUtfString(assembly_path),
+            allocUtfString(type_name),
+            allocUtfString(method_name),
+            policyPointer,
+        );
+
+        return ticket.toNumber();
+    },
+    poll: (bootstrapper: string, ticket: number) => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_poll");
+        const bootstrapper_poll = new NativeFunction(functionPointer, "uint32", ["uint64", "pointer"], { exceptions: "propagate" });
+
+        /// struct TicketReport { uint32_t status; uint64_t queue_ns; LoadReport load; uint64_t deferred_ns;
+        /// uint32_t cpu_percent; WorkerPolicy policy; }
+        const policyOffset = 32 + LOAD_REPORT_SIZE;
+        const report = Memory.alloc(policyOffset + 24);
+        const status = bootstrapper_poll(uint64(ticket), report);
+
+        return {
+            status: TICKET_STATUSES[status] ?? "Unknown",
+            queue_ns: report.add(8).readU64().toNumber(),
+            load: readLoadReport(report.add(16)),
+            deferred_ns: report.add(16 + LOAD_REPORT_SIZE).readU64().toNumber(),
+            cpu_percent: report.add(24 + LOAD_REPORT_SIZE).readU32(),
+            policy: {
+                nice: report.add(policyOffset).readS32(),
+                idle: report.add(policyOffset + 4).readU32() !== 0,
+                affinity_mask: report.add(policyOffset + 8).readU64().toString(),
+            },
+        };
+    },
+    injectBatch: (bootstrapper: string, runtime_config_path: string, assemblies: AssemblyDescriptor[]): number[] => {
+        const functionPointer = getBootstrapperExport(bootstrapper, "bootstrapper_load_assemblies");
+        const bootstrapper_load_assemblies = new NativeFunction(functionPointer, "uint32", ["pointer", "pointer", "size_t", "pointer"], { exceptions: "propagate" });
+
+        /// strings must stay reachable until the native call returns
+        const strings: NativePointer[] = [];
+        const descriptorSize = 3 * Process.pointerSize;
+        const descriptors = Memory.alloc(Math.max(assemblies.length, 1) * descriptorSize);
+        assemblies.forEach((assembly, i) => {
+            const descriptor = descriptors.add(i * descriptorSize);
+            [assembly.assembly_path, assembly.type_name, assembly.method_name].forEach((value, j) => {
+                const str = allocUtfString(value);
+                strings.push(str);
+                descriptor.add(j * Process.pointerSize).writePointer(str);
+            });
+        });
+
+        const results = Memory.alloc(Math.max(assemblies.length, 1) * 4);
+        bootstrapper_load_assemblies(allocUtfString(runtime_config_path), descriptors, assemblies.length, results);
+
+        return assemblies.map((_, i) => results.add(i * 4).readU32());
+    },
 };
@@ -2,6 +2,9 @@ import yargs from "yargs";
 import * as frida from "frida";
 import * as fs from "fs";
 import * as path from "path";
+import * as readline from "readline";
+import * as child_process from "child_process";
+import {performance} from "perf_hooks";
 
 enum InitializeResult {
     Success,
@@ -9,6 +12,461 @@ enum InitializeResult {
     InitializeRuntimeConfigError,
     GetRuntimeDelegateError,
     EntryPointError,
+    AlreadyLoaded,
+}
+
+/// JSON file describing set of payloads that share single runtime config, relative paths are resolved against it
+interface BatchManifest {
+    runtime_config_path: string;
+    assemblies: {
+        assembly_path: string;
+        type_name: string;
+        method_name: string;
+    }[];
+}
+
+async function loadAgent(process_name: string): Promise<frida.Script> {
+    const session = await frida.attach(process_name);
+
+    const source = fs.readFileSync("dist/agent.js", "utf8");
+
+    const script = await session.createScript(source);
+    await script.load();
+
+    return script;
+}
+
+/// Agent is compiled only once by the first attached session and then shared as bytecode by all others
+class AgentCache {
+    private bytes: Promise<Buffer> | null = null;
+    private readonly source = fs.readFileSync("dist/agent.js", "utf8");
+
+    async load(session: frida.Session): Promise<frida.Script> {
+        if (this.bytes === null) {
+            this.bytes = session.compileScript(this.source);
+        }
+
+        const script = await session.createScriptFromBytes(await this.bytes);
+        await script.load();
+
+        return script;
+    }
+}
+
+/// Producer side of shared memory ring created by `bootstrapper_open_channel`, layout is defined in
+/// `Bootstrapper/src/channel.cpp`. Segment is written with plain file writes, so only one sender may run at a time
+class ChannelWriter {
+    private static readonly MAGIC = 0x4349434e;
+    private static readonly VERSION = 2;
+    private static readonly HEADER_SIZE = 64;
+    private static readonly SLOT_HEADER_SIZE = 16;
+
+    private readonly fd: number;
+    /// FIFO the consumer blocks on once the ring is empty
+    private readonly wakeFd: number;
+    private readonly slotCount: bigint;
+    private readonly slotSize: number;
+    private position: bigint;
+
+    constructor(name: string) {
+        this.fd = fs.openSync(`/dev/shm/net-core-injector.${name}`, "r+");
+
+        const header = Buffer.alloc(ChannelWriter.HEADER_SIZE);
+        fs.readSync(this.fd, header, 0, header.length, 0);
+        if (header.readUInt32LE(0) !== ChannelWriter.MAGIC || header.readUInt32LE(4) !== ChannelWriter.VERSION) {
+            throw new Error(`${name} is not a channel of supported version`);
+        }
+
+        this.slotCount = BigInt(header.readUInt32LE(8));
+        this.slotSize = header.readUInt32LE(12);
+        this.position = header.readBigUInt64LE(16);
+        this.wakeFd = fs.openSync(`/dev/shm/net-core-injector.${name}.wake`, fs.constants.O_WRONLY | fs.constants.O_NONBLOCK);
+    }
+
+    /// Returns `false` if the consumer hasn't freed the next slot yet
+    trySend(message: Buffer): boolean {
+        if (message.length > this.slotSize) {
+            throw new Error(`message is longer than ${this.slotSize} bytes`);
+        }
+
+        const offset = ChannelWriter.HEADER_SIZE + Number(this.position % this.slotCount) * (ChannelWriter.SLOT_HEADER_SIZE + this.slotSize);
+
+        const sequence = Buffer.alloc(8);
+        fs.readSync(this.fd, sequence, 0, 8, offset);
+        if (sequence.readBigUInt64LE(0) !== this.position) {
+            return false;
+        }
+
+        const slot = Buffer.alloc(8 + message.length);
+        slot.writeUInt32LE(message.length, 0);
+        message.copy(slot, 8);
+        fs.writeSync(this.fd, slot, 0, slot.length, offset + 8);
+
+        /// sequence is published last, it's what the consumer waits for
+        this.position++;
+        sequence.writeBigUInt64LE(this.position, 0);
+        fs.writeSync(this.fd, sequence, 0, 8, offset);
+        fs.writeSync(this.fd, sequence, 0, 8, 16);
+
+        /// `consumer_waiting` is read only after the slot is published, the consumer checks in reverse order
+        const waiting = Buffer.alloc(4);
+        fs.readSync(this.fd, waiting, 0, 4, 32);
+        if (waiting.readUInt32LE(0) !== 0) {
+            try {
+                fs.writeSync(this.wakeFd, Buffer.alloc(1));
+            } catch (e: any) {
+                /// full pipe means the consumer has wakeups pending anyway
+                if (e.code !== "EAGAIN") {
+                    throw e;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    async send(message: Buffer, timeout_ms: number) {
+        const deadline = Date.now() + timeout_ms;
+        while (!this.trySend(message)) {
+            if (Date.now() > deadline) {
+                throw new Error("channel is full, is the consumer running?");
+            }
+            await new Promise((resolve) => setTimeout(resolve, 1));
+        }
+    }
+
+    close() {
+        fs.closeSync(this.wakeFd);
+        fs.closeSync(this.fd);
+    }
+}
+
+/// Raw counters of one `bootstrapper_stats_register` entry
+interface StatsEntry {
+    name: string;
+    total_ns: number;
+    max_ns: number;
+    buckets: number[];
+}
+
+/// Reader of segment created by `bootstrapper_stats_register`, layout is defined in `Bootstrapper/src/stats.cpp`.
+/// Counters are read with plain file reads while the process updates them, so entries are consistent only roughly
+class StatsReader {
+    private static readonly MAGIC = 0x5349434e;
+    private static readonly VERSION = 1;
+    private static readonly HEADER_SIZE = 64;
+    private static readonly ENTRY_SIZE = 384;
+    private static readonly BUCKETS_OFFSET = 16;
+    private static readonly NAME_OFFSET = 272;
+
+    static path(pid: number): string {
+        return `/dev/shm/net-core-injector.stats-${pid}`;
+    }
+
+    static read(pid: number): StatsEntry[] {
+        const segment = fs.readFileSync(StatsReader.path(pid));
+        if (segment.length < StatsReader.HEADER_SIZE || segment.readUInt32LE(0) !== StatsReader.MAGIC || segment.readUInt32LE(4) !== StatsReader.VERSION) {
+            throw new Error(`stats of ${pid} are not of supported version`);
+        }
+
+        const bucketCount = segment.readUInt32LE(12);
+        const count = Math.min(segment.readUInt32LE(16), segment.readUInt32LE(8));
+
+        return Array.from({length: count}, (_, i) => {
+            const offset = StatsReader.HEADER_SIZE + i * StatsReader.ENTRY_SIZE;
+            const name = segment.subarray(offset + StatsReader.NAME_OFFSET, offset + StatsReader.ENTRY_SIZE);
+            const end = name.indexOf(0);
+            return {
+                name: name.subarray(0, end < 0 ? name.length : end).toString("utf8"),
+                total_ns: Number(segment.readBigUInt64LE(offset)),
+                max_ns: Number(segment.readBigUInt64LE(offset + 8)),
+                buckets: Array.from({length: bucketCount}, (_, bucket) => Number(segment.readBigUInt64LE(offset + StatsReader.BUCKETS_OFFSET + bucket * 8))),
+            };
+        });
+    }
+
+    /// Percentiles are interpolated linearly inside of log2 bucket, so they are at most 2x off. If `previous` is given,
+    /// everything but `max_us` is for calls made since then
+    static summarize(entry: StatsEntry, previous?: StatsEntry) {
+        const buckets = entry.buckets.map((calls, i) => calls - (previous?.buckets[i] ?? 0));
+        const calls = buckets.reduce((sum, bucket) => sum + bucket, 0);
+        const total_ns = entry.total_ns - (previous?.total_ns ?? 0);
+
+        const percentile = (p: number) => {
+            let seen = 0;
+            for (const [i, bucket] of buckets.entries()) {
+                if (bucket !== 0 && seen + bucket >= p * calls) {
+                    const lower = i === 0 ? 0 : 2 ** i;
+                    const upper = i === buckets.length - 1 ? Math.max(entry.max_ns, lower) : 2 ** (i + 1);
+                    const ns = lower + (upper - lower) * (p * calls - seen) / bucket;
+                    return Number((ns / 1e3).toFixed(3));
+                }
+                seen += bucket;
+            }
+            return 0;
+        };
+
+        return {
+            name: entry.name,
+            calls,
+            mean_us: calls !== 0 ? Number((total_ns / calls / 1e3).toFixed(3)) : 0,
+            p50_us: percentile(0.5),
+            p99_us: percentile(0.99),
+            max_us: entry.max_ns / 1e3,
+        };
+    }
+}
+
+/// Unix time in milliseconds with sub-millisecond precision, comparable with timestamps printed by `DemoApplication`
+function now(): number {
+    return performance.timeOrigin + performance.now();
+}
+
+/// `DemoApplication` started by `benchmark` with `DEMO_TIMESTAMPS`, so time of every line is when it was printed
+class DemoProcess {
+    readonly child: child_process.ChildProcess;
+    readonly spawned_ms = now();
+    private waiters: {predicate: (number: number) => boolean, resolve: (time: number) => void, reject: (e: Error) => void}[] = [];
+
+    constructor(command: string, args: string[], env: Record<string, string>) {
+        this.child = child_process.spawn(command, args, {
+            env: {...process.env, DEMO_TIMESTAMPS: "1", ...env},
+            stdio: ["ignore", "pipe", "inherit"],
+        });
+
+        readline.createInterface({input: this.child.stdout!}).on("line", (line) => {
+            const match = /^Number: (-?\d+) @ ([\d.]+)$/.exec(line);
+            if (match === null) {
+                return;
+            }
+
+            const number = Number(match[1]);
+            this.waiters = this.waiters.filter((waiter) => {
+                if (waiter.predicate(number)) {
+                    waiter.resolve(Number(match[2]));
+                    return false;
+                }
+                return true;
+            });
+        });
+
+        this.child.on("exit", (code, signal) => {
+            for (const waiter of this.waiters) {
+                waiter.reject(new Error(`process exited with ${signal ?? code}`));
+            }
+            this.waiters = [];
+        });
+    }
+
+    /// Resolves with time of the first line printed from now on whose number matches `predicate`
+    waitFor(predicate: (number: number) => boolean, timeout_ms: number): Promise<number> {
+        const promise = new Promise<number>((resolve, reject) => {
+            const timer = setTimeout(() => reject(new Error(`no matching line in ${timeout_ms} ms`)), timeout_ms);
+            this.waiters.push({
+                predicate,
+                resolve: (time) => {
+                    clearTimeout(timer);
+                    resolve(time);
+                },
+                reject: (e) => {
+                    clearTimeout(timer);
+                    reject(e);
+                },
+            });
+        });
+
+        /// run may fail before it awaits the promise, e.g. if injection returned an error
+        promise.catch(() => {});
+        return promise;
+    }
+
+    kill() {
+        this.child.kill("SIGKILL");
+    }
+}
+
+/// Nearest-rank percentile of sorted samples
+function percentile(sorted: number[], p: number): number {
+    return sorted[Math.min(Math.max(Math.ceil(p * sorted.length) - 1, 0), sorted.length - 1)];
+}
+
+/// Converts CPU list in `taskset -c` format, e.g. "0,2-3", to affinity mask of the bootstrapper worker
+function parseCpuList(list: string): bigint {
+    let mask = BigInt(0);
+    for (const range of list.split(",").filter((range) => range.trim() !== "")) {
+        const [first, last = first] = range.split("-").map((cpu) => Number.parseInt(cpu, 10));
+        if (Number.isNaN(first) || Number.isNaN(last) || first > last || last > 63) {
+            throw new Error(`invalid CPU list: ${list}`);
+        }
+        for (let cpu = first; cpu <= last; ++cpu) {
+            mask |= BigInt(1) << BigInt(cpu);
+        }
+    }
+    return mask;
+}
+
+/// Runs `fn` over all items with at most `limit` of them in flight
+async function mapConcurrently<T, R>(items: T[], limit: number, fn: (item: T) => Promise<R>): Promise<R[]> {
+    const results = new Array<R>(items.length);
+    let next = 0;
+
+    const workers = Array.from({length: Math.min(Math.max(limit, 1), items.length)}, async () => {
+        while (next < items.length) {
+            const i = next++;
+            results[i] = await fn(items[i]);
+        }
+    });
+    await Promise.all(workers);
+
+    return results;
+}
+
+/// Pushes assembly, its PDB if it lies next to it and dependencies into agent memory,
+/// returns list in load order where the payload itself is the last one
+function postAssemblies(script: frida.Script, assembly_path: string, dependencies: string[]) {
+    return [...dependencies, assembly_path].map((file, i) => {
+        const assembly = `assembly-${i}`;
+        script.post({type: "buffer", name: assembly}, fs.readFileSync(file));
+
+        const pdb = file.replace(/\.dll$/i, ".pdb");
+        if (pdb === file || !fs.existsSync(pdb)) {
+            return {assembly, symbols: null};
+        }
+
+        const symbols = `symbols-${i}`;
+        script.post({type: "buffer", name: symbols}, fs.readFileSync(pdb));
+        return {assembly, symbols};
+    });
+}
+
+/// Per-phase timings and RSS deltas recorded by the bootstrapper during the last injection
+interface LoadReport {
+    result: number;
+    phases: {
+        name: string;
+        duration_ns: number;
+        rss_delta_bytes: number;
+    }[];
+    prefetch_files: number;
+    prefetch_bytes: number;
+    /// Wall time of reading them
+    prefetch_ns: number;
+}
+
+/// Result of `bootstrapper_probe`
+interface ProbeResult {
+    ret: number;
+    verdict: "Unknown" | "Compatible" | "Incompatible";
+    resolve_result: number;
+    hostfxr_version: string;
+    loaded_runtime_version: string;
+    installed_framework_count: number;
+    different_property_count: number;
+    frameworks: {
+        name: string;
+        requested_version: string;
+        resolved_version: string;
+        loaded_version: string;
+        resolved: boolean;
+    }[];
+}
+
+/// Probe verdicts keyed by runtime fingerprint and runtime config, persisted between runs,
+/// so processes whose runtime is known to be incompatible are skipped without attaching
+class ProbeCache {
+    private readonly entries: Record<string, string>;
+
+    constructor(private readonly file: string) {
+        this.entries = fs.existsSync(file) ? JSON.parse(fs.readFileSync(file, "utf8")) : {};
+    }
+
+    /// What a verdict depends on, read without attaching: the app, whose runtime config decides which frameworks and
+    /// `configProperties` the running runtime has, paths of hostfxr and coreclr, and framework directories mapped so
+    /// far. So a verdict of one app never applies to another app on the same runtime. `null` if it can't be read
+    static fingerprint(pid: number): string | null {
+        let maps: string;
+        let app: string;
+        try {
+            maps = fs.readFileSync(`/proc/${pid}/maps`, "utf8");
+            app = ProbeCache.appPath(pid);
+        } catch {
+            return null;
+        }
+
+        const libraries = new Set<string>();
+        const frameworks = new Set<string>();
+        for (const line of maps.split("\n")) {
+            const library = /\s(\/\S*\/lib(?:hostfxr|coreclr)\.so)$/.exec(line);
+            if (library !== null) {
+                libraries.add(library[1]);
+            }
+            const framework = /\/shared\/([^/\s]+\/[^/\s]+)\/[^/]+$/.exec(line);
+            if (framework !== null) {
+                frameworks.add(framework[1]);
+            }
+        }
+
+        if (libraries.size === 0) {
+            return null;
+        }
+        return [app, [...libraries].sort().join(":"), [...frameworks].sort().join(":")].join("|");
+    }
+
+    /// `dotnet app.dll` runs the first `.dll` argument, an apphost is the app itself
+    private static appPath(pid: number): string {
+        const exe = fs.readlinkSync(`/proc/${pid}/exe`);
+        if (path.basename(exe) === "dotnet") {
+            const args = fs.readFileSync(`/proc/${pid}/cmdline`, "utf8").split("\0").slice(1);
+            const dll = args.find(arg => arg.endsWith(".dll"));
+            if (dll !== undefined) {
+                return path.resolve(fs.readlinkSync(`/proc/${pid}/cwd`), dll);
+            }
+        }
+        return exe;
+    }
+
+    /// Config is part of the key, so editing it invalidates the verdict
+    private static key(fingerprint: string, runtime_config_path: string): string {
+        return `${fingerprint}|${runtime_config_path}|${fs.statSync(runtime_config_path).mtimeMs}`;
+    }
+
+    get(fingerprint: string, runtime_config_path: string): string | undefined {
+        return this.entries[ProbeCache.key(fingerprint, runtime_config_path)];
+    }
+
+    set(fingerprint: string, runtime_config_path: string, verdict: string) {
+        if (verdict !== "Unknown") {
+            this.entries[ProbeCache.key(fingerprint, runtime_config_path)] = verdict;
+        }
+    }
+
+    save() {
+        fs.writeFileSync(this.file, JSON.stringify(this.entries, null, 2));
+    }
+}
+
+function printReport(report: LoadReport) {
+    for (const phase of report.phases) {
+        const duration = (phase.duration_ns / 1e6).toFixed(3);
+        const rss = (phase.rss_delta_bytes / 1024).toFixed(0);
+        console.log(`[*]   ${phase.name.padEnd(24)} ${duration.padStart(10)} ms  RSS ${rss.padStart(8)} KiB`);
+    }
+
+    if (report.prefetch_files > 0) {
+        const size = (report.prefetch_bytes / 1024).toFixed(0);
+        const duration = (report.prefetch_ns / 1e6).toFixed(3);
+        console.log(`[*]   Prefetched ${report.prefetch_files} dependencies, ${size} KiB in ${duration} ms`);
+    }
+}
+
+/// Payload that is already in the process is what a repeated rollout expects, so it doesn't count as failure
+function isInjected(ret: number): boolean {
+    return ret === InitializeResult.Success || ret === InitializeResult.AlreadyLoaded;
+}
+
+function formatResult(ret: number): string {
+    const initialize_result = InitializeResult[ret] ?? "Unknown";
+    return `${ret} (InitializeResult::${initialize_result})`;
 }
 
 yargs(process.argv.slice(2))
@@ -22,31 +480,797 @@ yargs(process.argv.slice(2))
             .positional("assembly_path", {type: "string"})
             .positional("type_name", {type: "string"})
             .positional("method_name", {type: "string"})
+            .option("in-memory", {
+                type: "boolean",
+                default: false,
+                description: "push runtime config and assembly bytes into process instead of loading them from filesystem",
+            })
+            .option("dependency", {
+                type: "array",
+                string: true,
+                default: [],
+                description: "assembly to load from memory before the payload, e.g. 0Harmony.dll",
+            })
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print result and per-phase report as JSON",
+            })
+            .option("hostfxr", {
+                type: "string",
+                description: "path to hostfxr to load if none is mapped into process, injection still needs the app's own hostfxr",
+            })
+            .option("async", {
+                type: "boolean",
+                default: false,
+                description: "run injection on bootstrapper worker thread and poll for completion",
+            })
+            .option("nice", {
+                type: "number",
+                description: "nice value of the worker thread, implies --async",
+            })
+            .option("idle", {
+                type: "boolean",
+                description: "run the worker thread under SCHED_IDLE, implies --async",
+            })
+            .option("affinity", {
+                type: "string",
+                description: "CPUs the worker thread may run on, e.g. 0,2-3, implies --async",
+            })
+            .option("defer-cpu", {
+                type: "number",
+                description: "wait until the process uses less than this many percent of one core, implies --async",
+            })
+            .option("defer-max-ms", {
+                type: "number",
+                default: 5000,
+                description: "start injection anyway after deferring it for this long",
+            })
     }, async (argv: any) => {
-        const session = await frida.attach(argv.process_name);
+        const scheduled = argv.nice !== undefined || argv.idle !== undefined || argv.affinity !== undefined ||
+            argv.deferCpu !== undefined;
+        const affinity = argv.affinity !== undefined ? parseCpuList(argv.affinity) : BigInt(0);
+        if (argv.inMemory && (argv.async || scheduled)) {
+            throw new Error("--in-memory loads synchronously, it can't be combined with --async or worker scheduling");
+        }
 
-        const source = fs.readFileSync("dist/agent.js", "utf8");
+        const script = await loadAgent(argv.process_name);
 
-        const script = await session.createScript(source);
-        await script.load();
+        const api: any = script.exports;
+        if (argv.hostfxr !== undefined) {
+            await api.setHostFxrPath(path.resolve(argv.bootstrapper), path.resolve(argv.hostfxr));
+        }
+        let ret: number;
+        let report: LoadReport | null = null;
+        if (argv.async || scheduled) {
+            const ticket: number = await api.injectAsync(
+                path.resolve(argv.bootstrapper),
+                path.resolve(argv.runtime_config_path),
+                path.resolve(argv.assembly_path),
+                argv.type_name,
+                argv.method_name,
+                /// scheduling belongs to this ticket, later jobs in the process keep the default one
+                scheduled ? {
+                    nice: argv.nice ?? 0,
+                    idle: argv.idle ?? false,
+                    affinity_mask: affinity.toString(),
+                    defer_cpu_percent: argv.deferCpu ?? 0,
+                    defer_max_ms: argv.deferMaxMs,
+                } : undefined,
+            );
+
+            /// every poll is a short native call, so frida session isn't blocked by a heavy entry point
+            let status;
+            while ((status = await api.poll(path.resolve(argv.bootstrapper), ticket)).status !== "Completed") {
+                if (status.status === "Unknown") {
+                    throw new Error(`ticket ${ticket} is unknown`);
+                }
+                await new Promise((resolve) => setTimeout(resolve, 50));
+            }
+
+            if (!argv.json) {
+                console.log(`[*] ticket ${ticket} waited ${(status.queue_ns / 1e6).toFixed(3)} ms for worker`);
+                if (scheduled) {
+                    const policy = status.policy;
+                    console.log(`[*] worker ran with nice=${policy.nice} idle=${policy.idle} ` +
+                        `affinity=0x${BigInt(policy.affinity_mask).toString(16)}, deferred ` +
+                        `${(status.deferred_ns / 1e6).toFixed(3)} ms at ${status.cpu_percent}% CPU`);
+                }
+            }
+            ret = status.load.result;
+            report = status.load;
+        } else if (argv.inMemory) {
+            const assemblies = postAssemblies(
+                script,
+                path.resolve(argv.assembly_path),
+                argv.dependency.map((dependency: string) => path.resolve(dependency)),
+            );
+            script.post({type: "buffer", name: "runtimeconfig"}, fs.readFileSync(argv.runtime_config_path));
+            ret = await api.injectBytes(
+                path.resolve(argv.bootstrapper),
+                "runtimeconfig",
+                assemblies,
+                argv.type_name,
+                argv.method_name,
+            );
+        } else {
+            ret = await api.inject(
+                path.resolve(argv.bootstrapper),
+                path.resolve(argv.runtime_config_path),
+                path.resolve(argv.assembly_path),
+                argv.type_name,
+                argv.method_name,
+            );
+        }
+
+        if (report === null) {
+            report = await api.getLastReport(path.resolve(argv.bootstrapper)) as LoadReport;
+        }
+
+        if (argv.json) {
+            console.log(JSON.stringify({process_name: argv.process_name, result: ret, phases: report.phases}));
+        } else {
+            console.log(`[*] api.inject() => ${formatResult(ret)}`);
+            printReport(report);
+        }
+
+        if (!isInjected(ret)) {
+            console.log(`An error occurred while injection into ${argv.process_name}`);
+        }
+
+        await script.unload();
+    })
+    .command("probe <process_name> <bootstrapper> <runtime_config_path>", "check whether runtime config fits runtime of process without initializing anything", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .option("hostfxr", {
+                type: "string",
+                description: "path to hostfxr to load if none is mapped into process",
+            })
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print probe result as JSON",
+            })
+            .option("probe-cache", {
+                type: "string",
+                description: "file to store verdict in, see `inject-many --probe-cache`",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
 
         const api: any = script.exports;
-        const ret = await api.inject(
+        if (argv.hostfxr !== undefined) {
+            await api.setHostFxrPath(path.resolve(argv.bootstrapper), path.resolve(argv.hostfxr));
+        }
+
+        const runtime_config_path = path.resolve(argv.runtime_config_path);
+        const probe: ProbeResult = await api.probe(path.resolve(argv.bootstrapper), runtime_config_path);
+
+        if (argv.probeCache !== undefined) {
+            const target = await (await frida.getLocalDevice()).getProcess(argv.process_name);
+            const fingerprint = ProbeCache.fingerprint(target.pid);
+            if (fingerprint !== null) {
+                const cache = new ProbeCache(argv.probeCache);
+                cache.set(fingerprint, runtime_config_path, probe.verdict);
+                cache.save();
+            }
+        }
+
+        if (argv.json) {
+            console.log(JSON.stringify({process_name: argv.process_name, ...probe}));
+        } else {
+            console.log(`[*] api.probe() => ${formatResult(probe.ret)}, verdict ${probe.verdict}`);
+            console.log(`[*]   hostfxr ${probe.hostfxr_version || "?"}, ${probe.installed_framework_count} frameworks installed, running runtime ${probe.loaded_runtime_version || "none"}`);
+            if (probe.different_property_count !== 0) {
+                console.log(`[*]   ${probe.different_property_count} configProperties differ from the running app`);
+            }
+            if (probe.frameworks.length !== 0) {
+                console.table(probe.frameworks);
+            }
+        }
+
+        await script.unload();
+    })
+    .command("diagnostics <process_name> <bootstrapper>", "drain events recorded by bootstrapper since the last drain", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print one JSON line per event",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const {events, dropped} = await api.drainDiagnostics(path.resolve(argv.bootstrapper));
+
+        for (const event of events) {
+            if (argv.json) {
+                console.log(JSON.stringify(event));
+            } else {
+                const time = new Date(event.timestamp_us / 1000).toISOString();
+                console.log(`${time} ${event.kind.padEnd(12)} ${formatResult(event.result)} ${event.value} ${event.message}`);
+            }
+        }
+
+        if (dropped !== 0) {
+            console.log(`[*] ${dropped} events were overwritten before they were drained`);
+        }
+
+        await script.unload();
+    })
+    .command("list <process_name> <bootstrapper>", "list payloads that are already loaded into process", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print one JSON line per payload",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const payloads = await api.listPayloads(path.resolve(argv.bootstrapper));
+
+        for (const payload of payloads) {
+            if (argv.json) {
+                console.log(JSON.stringify(payload));
+            } else {
+                const time = new Date(payload.loaded_at_us / 1000).toISOString();
+                const assembly = payload.in_memory ? "<memory>" : payload.assembly_path;
+                const entry_point = payload.type_name ? `${payload.type_name}::${payload.method_name}` : "(dependency)";
+                console.log(`${time} ${payload.content_hash} ${assembly} ${entry_point}, ${payload.repeat_count} repeats skipped`);
+            }
+        }
+
+        if (payloads.length === 0 && !argv.json) {
+            console.log(`[*] no payloads are loaded into ${argv.process_name}`);
+        }
+
+        await script.unload();
+    })
+    .command("stats <pid>", "print call counts and latencies of instrumented patches without attaching", (yargs) => {
+        yargs
+            .positional("pid", {type: "number"})
+            .option("interval", {
+                type: "number",
+                description: "print calls made during every interval of this many milliseconds until interrupted",
+            })
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print one JSON line per patch",
+            })
+    }, async (argv: any) => {
+        const print = (rows: ReturnType<typeof StatsReader.summarize>[]) => {
+            if (argv.json) {
+                for (const row of rows) {
+                    console.log(JSON.stringify({pid: argv.pid, ...row}));
+                }
+            } else {
+                console.table(rows);
+            }
+        };
+
+        let previous = StatsReader.read(argv.pid);
+        if (argv.interval === undefined) {
+            print(previous.map((entry) => StatsReader.summarize(entry)));
+        }
+
+        while (argv.interval !== undefined) {
+            await new Promise((resolve) => setTimeout(resolve, argv.interval));
+            if (!fs.existsSync(StatsReader.path(argv.pid)) || !fs.existsSync(`/proc/${argv.pid}`)) {
+                break;
+            }
+
+            const current = StatsReader.read(argv.pid);
+            print(current.map((entry, i) => StatsReader.summarize(entry, previous[i])));
+            previous = current;
+        }
+
+        /// Segment is unlinked on normal exit only, e.g. not if the process was killed
+        if (!fs.existsSync(`/proc/${argv.pid}`) && fs.existsSync(StatsReader.path(argv.pid))) {
+            fs.unlinkSync(StatsReader.path(argv.pid));
+            console.log(`[*] process ${argv.pid} is not running anymore, its stats were removed`);
+        }
+    })
+    .command("benchmark <demo> <bootstrapper> <runtime_config_path> <assembly_path> <type_name> <method_name>", "measure how long it takes until patch of DemoApplication is active in LD_PRELOAD, attach and native injector modes", (yargs) => {
+        yargs
+            .positional("demo", {type: "string", description: "path to DemoApplication executable"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .positional("assembly_path", {type: "string"})
+            .positional("type_name", {type: "string"})
+            .positional("method_name", {type: "string"})
+            .option("mode", {
+                type: "array",
+                choices: ["preload", "attach", "injector", "launch"],
+                default: ["preload", "attach"],
+                description: "injection paths to measure, attach and injector need ptrace permission, injector needs --injector and launch needs --launcher",
+            })
+            .option("launcher", {
+                type: "string",
+                description: "path to launcher of the bootstrapper, DemoApplication.dll is expected next to <demo>",
+            })
+            .option("injector", {
+                type: "string",
+                description: "path to frida-free injector of the bootstrapper",
+            })
+            .option("runs", {
+                type: "number",
+                default: 20,
+                description: "measured runs per mode",
+            })
+            .option("warmup", {
+                type: "number",
+                default: 1,
+                description: "runs per mode that are not counted, e.g. to compile the agent and fill page cache",
+            })
+            .option("interval", {
+                type: "number",
+                default: 10,
+                description: "how often DemoApplication prints a number in milliseconds, it bounds the resolution",
+            })
+            .option("timeout", {
+                type: "number",
+                default: 30000,
+                description: "how long a single run may take in milliseconds",
+            })
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print one JSON line per metric",
+            })
+    }, async (argv: any) => {
+        const demo = path.resolve(argv.demo);
+        const bootstrapper = path.resolve(argv.bootstrapper);
+        const runtime_config_path = path.resolve(argv.runtime_config_path);
+        const assembly_path = path.resolve(argv.assembly_path);
+        const demoEnv = {
+            DEMO_INTERVAL_MS: `${argv.interval}`,
+            DEMO_ITERATIONS: `${Math.ceil(2 * argv.timeout / Math.max(argv.interval, 1)) + 1}`,
+        };
+        const patched = (number: number) => number === 1337;
+        const any = () => true;
+
+        /// Every run returns metric => milliseconds
+        const modes: Record<string, () => Promise<Record<string, number>>> = {};
+
+        modes["preload"] = async () => {
+            const target = new DemoProcess(demo, [], {
+                ...demoEnv,
+                LD_PRELOAD: bootstrapper,
+                RUNTIME_CONFIG_PATH: runtime_config_path,
+                ASSEMBLY_PATH: assembly_path,
+                TYPE_NAME: argv.type_name,
+                METHOD_NAME: argv.method_name,
+            });
+            try {
+                const first = target.waitFor(any, argv.timeout);
+                const active = target.waitFor(patched, argv.timeout);
+                return {
+                    "spawn -> first line": await first - target.spawned_ms,
+                    "spawn -> patched": await active - target.spawned_ms,
+                };
+            } finally {
+                target.kill();
+            }
+        };
+
+        const device = await frida.getLocalDevice();
+        const agent = new AgentCache();
+        modes["attach"] = async () => {
+            const target = new DemoProcess(demo, [], demoEnv);
+            try {
+                const first = await target.waitFor(any, argv.timeout);
+                const active = target.waitFor(patched, argv.timeout);
+
+                const start = now();
+                const session = await device.attach(target.child.pid!);
+                const script = await agent.load(session);
+                const ret = await (script.exports as any).inject(bootstrapper, runtime_config_path, assembly_path, argv.type_name, argv.method_name);
+                const injected = now();
+                await script.unload();
+                await session.detach();
+                if (ret !== 0) {
+                    throw new Error(`api.inject() => ${formatResult(ret)}`);
+                }
+
+                return {
+                    "spawn -> first line": first - target.spawned_ms,
+                    "attach -> inject returned": injected - start,
+                    "attach -> patched": await active - start,
+                };
+            } finally {
+                target.kill();
+            }
+        };
+
+        /// Same as attach, but through the ptrace injector, which exits once the payload's entry point returned
+        modes["injector"] = async () => {
+            if (argv.injector === undefined) {
+                throw new Error("--injector is required");
+            }
+
+            const target = new DemoProcess(demo, [], demoEnv);
+            try {
+                const first = await target.waitFor(any, argv.timeout);
+                const active = target.waitFor(patched, argv.timeout);
+
+                const start = now();
+                const code = await new Promise<number | null>((resolve, reject) => {
+                    const injector = child_process.spawn(path.resolve(argv.injector), [
+                        `${target.child.pid}`, bootstrapper, runtime_config_path, assembly_path,
+                        argv.type_name, argv.method_name, `${argv.timeout}`,
+                    ], {stdio: "ignore"});
+                    injector.on("error", reject);
+                    injector.on("exit", resolve);
+                });
+                const injected = now();
+                if (code !== 0) {
+                    throw new Error(`injector exited with ${code}`);
+                }
+
+                return {
+                    "spawn -> first line": first - target.spawned_ms,
+                    "attach -> inject returned": injected - start,
+                    "attach -> patched": await active - start,
+                };
+            } finally {
+                target.kill();
+            }
+        };
+
+        modes["launch"] = async () => {
+            if (argv.launcher === undefined) {
+                throw new Error("--launcher is required");
+            }
+
+            const target = new DemoProcess(path.resolve(argv.launcher), [
+                "--payload", assembly_path, argv.type_name, argv.method_name,
+                demo.replace(/(\.exe)?$/i, ".dll"),
+            ], demoEnv);
+            try {
+                const first = target.waitFor(any, argv.timeout);
+                const active = target.waitFor(patched, argv.timeout);
+                return {
+                    "spawn -> first line": await first - target.spawned_ms,
+                    "spawn -> patched": await active - target.spawned_ms,
+                };
+            } finally {
+                target.kill();
+            }
+        };
+
+        const rows = [];
+        for (const mode of new Set<string>(argv.mode)) {
+            const samples: Record<string, number[]> = {};
+            const errors: string[] = [];
+            for (let run = 0; run < argv.warmup + argv.runs; run++) {
+                try {
+                    const metrics = await modes[mode]();
+                    for (const [metric, ms] of Object.entries(metrics)) {
+                        if (run >= argv.warmup) {
+                            (samples[metric] ??= []).push(ms);
+                        }
+                    }
+                } catch (e) {
+                    errors.push(`${e}`);
+                }
+            }
+
+            for (const error of new Set(errors)) {
+                console.log(`[-] ${mode}: ${error}`);
+            }
+
+            for (const [metric, values] of Object.entries(samples)) {
+                const sorted = values.sort((a, b) => a - b);
+                rows.push({
+                    mode,
+                    metric,
+                    runs: sorted.length,
+                    failed: errors.length,
+                    min_ms: Number(sorted[0].toFixed(1)),
+                    median_ms: Number(percentile(sorted, 0.5).toFixed(1)),
+                    p99_ms: Number(percentile(sorted, 0.99).toFixed(1)),
+                });
+            }
+        }
+
+        if (argv.json) {
+            for (const row of rows) {
+                console.log(JSON.stringify(row));
+            }
+        } else {
+            console.table(rows);
+        }
+
+        if (rows.some((row) => row.failed !== 0) || rows.length === 0) {
+            process.exitCode = 1;
+        }
+    })
+    .command("inject-batch <process_name> <bootstrapper> <manifest>", "inject set of C# libraries into process in one attach", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("manifest", {type: "string"})
+    }, async (argv: any) => {
+        const manifestPath = path.resolve(argv.manifest);
+        const manifestDir = path.dirname(manifestPath);
+        const manifest: BatchManifest = JSON.parse(fs.readFileSync(manifestPath, "utf8"));
+
+        const assemblies = manifest.assemblies.map((assembly) => ({
+            ...assembly,
+            assembly_path: path.resolve(manifestDir, assembly.assembly_path),
+        }));
+
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const results: number[] = await api.injectBatch(
+            path.resolve(argv.bootstrapper),
+            path.resolve(manifestDir, manifest.runtime_config_path),
+            assemblies,
+        );
+
+        results.forEach((ret, i) => {
+            console.log(`[*] ${assemblies[i].assembly_path} => ${formatResult(ret)}`);
+        });
+
+        const failed = results.filter((ret) => !isInjected(ret)).length;
+        if (failed !== 0) {
+            console.log(`${failed} of ${results.length} payloads failed to inject into ${argv.process_name}`);
+        }
+
+        await script.unload();
+    })
+    .command("invoke <process_name> <bootstrapper> <runtime_config_path> <assembly_path> <type_name> <method_name>", "call managed method of already injected C# library", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .positional("assembly_path", {type: "string", description: "pass empty string for assemblies loaded from memory"})
+            .positional("type_name", {type: "string"})
+            .positional("method_name", {type: "string"})
+            .option("arg", {
+                type: "string",
+                default: "",
+                description: "UTF-8 string passed to the method as (IntPtr arg, int argSize)",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const {ret, result} = await api.invoke(
+            path.resolve(argv.bootstrapper),
+            path.resolve(argv.runtime_config_path),
+            argv.assembly_path !== "" ? path.resolve(argv.assembly_path) : null,
+            argv.type_name,
+            argv.method_name,
+            [...Buffer.from(argv.arg, "utf8")],
+        );
+
+        console.log(`[*] api.invoke() => ${formatResult(ret)}, method returned ${result}`);
+
+        await script.unload();
+    })
+    .command("open-channel <process_name> <bootstrapper> <runtime_config_path> <assembly_path> <type_name> <method_name> <name>", "create shared memory channel whose messages are passed to managed method", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .positional("assembly_path", {type: "string", description: "pass empty string for assemblies loaded from memory"})
+            .positional("type_name", {type: "string"})
+            .positional("method_name", {type: "string"})
+            .positional("name", {type: "string"})
+            .option("slots", {
+                type: "number",
+                default: 1024,
+                description: "capacity of the ring, must be power of two",
+            })
+            .option("slot-size", {
+                type: "number",
+                default: 256,
+                description: "max message size in bytes",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const ok = await api.openChannel(
             path.resolve(argv.bootstrapper),
+            argv.name,
+            argv.slots,
+            argv.slotSize,
             path.resolve(argv.runtime_config_path),
+            argv.assembly_path !== "" ? path.resolve(argv.assembly_path) : null,
+            argv.type_name,
+            argv.method_name,
+        );
+
+        console.log(ok ? `[*] channel ${argv.name} is open` : `Failed to open channel ${argv.name} in ${argv.process_name}`);
+
+        await script.unload();
+    })
+    .command("watch <process_name> <bootstrapper> <runtime_config_path> <shim_path> <assembly_path> <type_name> <method_name>", "inject C# library and reload it every time it is rebuilt", (yargs) => {
+        yargs
+            .positional("process_name", {type: "string"})
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .positional("shim_path", {type: "string", description: "path to ReloadShim.dll"})
+            .positional("assembly_path", {type: "string"})
+            .positional("type_name", {type: "string"})
+            .positional("method_name", {type: "string"})
+            .option("unload", {
+                type: "string",
+                default: "",
+                description: "method that is called before the previous build is unloaded",
+            })
+    }, async (argv: any) => {
+        const script = await loadAgent(argv.process_name);
+
+        const api: any = script.exports;
+        const ret = await api.watch(
+            path.resolve(argv.bootstrapper),
+            path.resolve(argv.runtime_config_path),
+            path.resolve(argv.shim_path),
             path.resolve(argv.assembly_path),
             argv.type_name,
             argv.method_name,
+            argv.unload !== "" ? argv.unload : null,
         );
 
-        const initialize_result = InitializeResult[ret] ?? "Unknown";
-        console.log(`[*] api.inject() => ${ret} (InitializeResult::${initialize_result})`);
+        console.log(`[*] api.watch() => ${formatResult(ret)}`);
 
-        if (ret !== 0) {
-            console.log(`An error occurred while injection into ${argv.process_name}`);
+        await script.unload();
+    })
+    .command("send <name> [messages..]", "write messages into channel without attaching, reads lines from stdin if none are given", (yargs) => {
+        yargs
+            .positional("name", {type: "string"})
+            .positional("messages", {type: "string", array: true})
+            .option("timeout", {
+                type: "number",
+                default: 5000,
+                description: "how long to wait for free slot in milliseconds",
+            })
+    }, async (argv: any) => {
+        const channel = new ChannelWriter(argv.name);
+
+        let sent = 0;
+        const messages: string[] = argv.messages ?? [];
+        if (messages.length !== 0) {
+            for (const message of messages) {
+                await channel.send(Buffer.from(message, "utf8"), argv.timeout);
+                sent++;
+            }
+        } else {
+            for await (const line of readline.createInterface({input: process.stdin})) {
+                await channel.send(Buffer.from(line, "utf8"), argv.timeout);
+                sent++;
+            }
         }
 
-        await script.unload();
+        channel.close();
+        console.log(`[*] sent ${sent} messages`);
+    })
+    .command("inject-many <bootstrapper> <runtime_config_path> <assembly_path> <type_name> <method_name>", "inject C# library into many processes concurrently", (yargs) => {
+        yargs
+            .positional("bootstrapper", {type: "string"})
+            .positional("runtime_config_path", {type: "string"})
+            .positional("assembly_path", {type: "string"})
+            .positional("type_name", {type: "string"})
+            .positional("method_name", {type: "string"})
+            .option("pid", {
+                type: "array",
+                number: true,
+                default: [],
+                description: "process id to inject into",
+            })
+            .option("pattern", {
+                type: "string",
+                description: "regular expression that process name should match",
+            })
+            .option("concurrency", {
+                type: "number",
+                default: 8,
+                description: "how many processes are injected at the same time",
+            })
+            .option("json", {
+                type: "boolean",
+                default: false,
+                description: "print one JSON line with per-phase report for each process instead of table",
+            })
+            .option("probe-cache", {
+                type: "string",
+                description: "probe runtime of each process before injection and cache verdicts in this file, processes with runtime known to be incompatible are not attached",
+            })
+    }, async (argv: any) => {
+        const device = await frida.getLocalDevice();
+        const processes = await device.enumerateProcesses();
+
+        const pids = new Set<number>(argv.pid);
+        const pattern = argv.pattern !== undefined ? new RegExp(argv.pattern) : null;
+        const targets = processes.filter((p) => pids.has(p.pid) || (pattern !== null && pattern.test(p.name)));
+
+        if (targets.length === 0) {
+            console.log("No processes matched");
+            return;
+        }
+
+        const agent = new AgentCache();
+        const bootstrapper = path.resolve(argv.bootstrapper);
+        const runtime_config_path = path.resolve(argv.runtime_config_path);
+        const assembly_path = path.resolve(argv.assembly_path);
+        const probeCache = argv.probeCache !== undefined ? new ProbeCache(argv.probeCache) : null;
+
+        const rows = await mapConcurrently(targets, argv.concurrency, async (target) => {
+            const start = process.hrtime.bigint();
+            let result: string;
+            let ok = false;
+            let report: LoadReport | null = null;
+            let session: frida.Session | null = null;
+            let script: frida.Script | null = null;
+            try {
+                const fingerprint = probeCache !== null ? ProbeCache.fingerprint(target.pid) : null;
+                const verdict = fingerprint !== null ? probeCache!.get(fingerprint, runtime_config_path) : undefined;
+                if (verdict === "Incompatible") {
+                    throw new Error("skipped, runtime is known to be incompatible");
+                }
+
+                session = await device.attach(target.pid);
+                script = await agent.load(session);
+
+                const api: any = script.exports;
+                let probe: ProbeResult | null = null;
+                if (probeCache !== null && verdict === undefined) {
+                    probe = await api.probe(bootstrapper, runtime_config_path);
+                    if (fingerprint !== null) {
+                        probeCache.set(fingerprint, runtime_config_path, probe!.verdict);
+                    }
+                }
+
+                if (probe?.verdict === "Incompatible") {
+                    result = `incompatible with running runtime ${probe.loaded_runtime_version || "?"}`;
+                } else {
+                    const ret = await api.inject(bootstrapper, runtime_config_path, assembly_path, argv.type_name, argv.method_name);
+                    report = await api.getLastReport(bootstrapper);
+                    result = formatResult(ret);
+                    ok = isInjected(ret);
+                }
+            } catch (e) {
+                result = `${e}`;
+            } finally {
+                /// Target may have exited meanwhile, that must not hide the result
+                await script?.unload().catch(() => {});
+                await session?.detach().catch(() => {});
+            }
+
+            const time_ms = Number(process.hrtime.bigint() - start) / 1e6;
+            return {pid: target.pid, name: target.name, result, ok, time_ms: Number(time_ms.toFixed(1)), report};
+        });
+
+        if (argv.json) {
+            for (const {ok, report, ...row} of rows) {
+                console.log(JSON.stringify({...row, phases: report?.phases ?? []}));
+            }
+        } else {
+            console.table(rows.map(({ok, report, ...row}) => row));
+        }
+
+        probeCache?.save();
+
+        const failed = rows.filter((row) => !row.ok).length;
+        if (failed !== 0) {
+            console.log(`${failed} of ${rows.length} processes failed`);
+            process.exitCode = 1;
+        }
     })
     .demandCommand(1)
     .help()